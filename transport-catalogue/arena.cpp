@@ -0,0 +1,83 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace TransportInformator
+{
+
+namespace detail
+{
+
+MonotonicArena::MonotonicArena(size_t block_size) : block_size_{block_size} {}
+
+MonotonicArena::MonotonicArena(MonotonicArena&& other) noexcept
+    : block_size_{other.block_size_}
+    , blocks_{std::move(other.blocks_)}
+    , current_{std::exchange(other.current_, nullptr)}
+    , left_in_block_{std::exchange(other.left_in_block_, 0)}
+    , bytes_used_{std::exchange(other.bytes_used_, 0)}
+{
+    other.blocks_.clear();
+}
+
+MonotonicArena& MonotonicArena::operator=(MonotonicArena&& other) noexcept
+{
+    if (this != &other)
+    {
+        block_size_ = other.block_size_;
+        blocks_ = std::move(other.blocks_);
+        other.blocks_.clear();
+        current_ = std::exchange(other.current_, nullptr);
+        left_in_block_ = std::exchange(other.left_in_block_, 0);
+        bytes_used_ = std::exchange(other.bytes_used_, 0);
+    }
+    return *this;
+}
+
+void* MonotonicArena::Allocate(size_t bytes, size_t alignment)
+{
+    size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(current_) % alignment) % alignment;
+    if (current_ == nullptr || padding + bytes > left_in_block_)
+    {
+        // Запросы крупнее блока получают собственный блок подходящего размера
+        const size_t new_block_size = std::max(block_size_, bytes + alignment);
+        blocks_.push_back({std::make_unique<char[]>(new_block_size), new_block_size});
+        current_ = blocks_.back().data.get();
+        left_in_block_ = new_block_size;
+        padding = (alignment - reinterpret_cast<std::uintptr_t>(current_) % alignment) % alignment;
+    }
+
+    char* result = current_ + padding;
+    current_ = result + bytes;
+    left_in_block_ -= padding + bytes;
+    bytes_used_ += bytes;
+    return result;
+}
+
+std::string_view MonotonicArena::CopyString(std::string_view str)
+{
+    if (str.empty())
+    {
+        return {};
+    }
+    char* dest = static_cast<char*>(Allocate(str.size(), alignof(char)));
+    std::memcpy(dest, str.data(), str.size());
+    return {dest, str.size()};
+}
+
+size_t MonotonicArena::GetBlockCount() const
+{
+    return blocks_.size();
+}
+
+size_t MonotonicArena::GetBytesUsed() const
+{
+    return bytes_used_;
+}
+
+} // namespace TransportInformator::detail
+
+} // namespace TransportInformator
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace TransportInformator
+{
+
+namespace detail
+{
+
+// Невладеющее представление непрерывного массива (аналог std::span из C++20)
+template <typename T>
+class Span
+{
+    public:
+    using value_type = T;
+    using iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    Span() = default;
+    Span(const T* data, size_t size) : data_{data}, size_{size} {}
+
+    iterator begin() const { return data_; }
+    iterator end() const { return data_ + size_; }
+    reverse_iterator rbegin() const { return reverse_iterator{end()}; }
+    reverse_iterator rend() const { return reverse_iterator{begin()}; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T& operator[](size_t index) const { return data_[index]; }
+    const T& front() const { return data_[0]; }
+    const T& back() const { return data_[size_ - 1]; }
+    const T* data() const { return data_; }
+
+    private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Монотонный аллокатор: память выделяется крупными блоками и освобождается
+// только вместе с самим аллокатором. Адреса выданных объектов стабильны.
+class MonotonicArena
+{
+    public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit MonotonicArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+    // Блоки переходят к новому владельцу, исходная арена остаётся пустой
+    MonotonicArena(MonotonicArena&& other) noexcept;
+    MonotonicArena& operator=(MonotonicArena&& other) noexcept;
+
+    void* Allocate(size_t bytes, size_t alignment);
+
+    // Копирует строку в арену и возвращает представление на копию
+    std::string_view CopyString(std::string_view str);
+
+    // Копирует тривиально копируемые элементы массива в арену
+    template <typename T>
+    Span<T> CopyArray(const std::vector<T>& values);
+
+    size_t GetBlockCount() const;
+    size_t GetBytesUsed() const;
+
+    private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    char* current_ = nullptr;
+    size_t left_in_block_ = 0;
+    size_t bytes_used_ = 0;
+};
+
+template <typename T>
+Span<T> MonotonicArena::CopyArray(const std::vector<T>& values)
+{
+    if (values.empty())
+    {
+        return {};
+    }
+    T* dest = static_cast<T*>(Allocate(values.size() * sizeof(T), alignof(T)));
+    std::uninitialized_copy(values.begin(), values.end(), dest);
+    return {dest, values.size()};
+}
+
+} // namespace TransportInformator::detail
+
+} // namespace TransportInformator
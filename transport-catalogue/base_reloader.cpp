@@ -0,0 +1,117 @@
+#include "base_reloader.h"
+
+#include <chrono>
+
+namespace TransportInformator
+{
+
+namespace Service
+{
+
+std::shared_ptr<BaseGeneration> LoadBaseGeneration(const Serialize::SerializationParameters& pars, size_t number)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    auto generation = std::make_shared<BaseGeneration>();
+    generation->number = number;
+
+    auto tc = std::make_shared<Core::TransportCatalogue>();
+    Serialize::Serializator serializer{*tc, pars};
+    generation->router.reset(new Router::TransportRouter(serializer.UnserializeFromFile()));
+    generation->catalogue = Core::TransportCatalogue::Freeze(std::move(tc));
+
+    generation->renderer = std::make_unique<Render::MapRenderer>(serializer.GetRenderSettings(),
+                                                                 generation->catalogue->GetAllNonEmptyStopsCoords());
+    generation->handler = std::make_unique<ReqHandler::RequestHandler>(*generation->catalogue, *generation->renderer,
+                                                                       *generation->router);
+
+    if (serializer.GetRenderedMap().empty())
+    {
+        generation->handler->SetRenderedMap(generation->handler->RenderMapSvg());
+    }
+    else
+    {
+        generation->handler->SetRenderedMap(serializer.GetRenderedMap());
+    }
+    // поколение публикуется только для чтения, поэтому индексы для запросов строятся до публикации
+    generation->handler->PrepareMapIndices();
+
+    generation->load_time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return generation;
+}
+
+BaseReloader::BaseReloader(Serialize::SerializationParameters pars, std::ostream& log) : pars_{std::move(pars)}, log_{log}
+{
+    std::shared_ptr<BaseGeneration> generation = LoadBaseGeneration(pars_, 1);
+    SetReloadTrigger(*generation);
+    current_.Reset(std::move(generation));
+}
+
+BaseReloader::~BaseReloader()
+{
+    WaitReload();
+}
+
+std::shared_ptr<const BaseGeneration> BaseReloader::GetCurrent() const
+{
+    return current_.Get();
+}
+
+bool BaseReloader::StartReload()
+{
+    std::lock_guard guard(worker_mutex_);
+    if (reloading_)
+    {
+        return false;
+    }
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+
+    reloading_ = true;
+    worker_ = std::thread([this, number = GetCurrent()->number + 1] { Reload(number); });
+    return true;
+}
+
+void BaseReloader::WaitReload()
+{
+    std::lock_guard guard(worker_mutex_);
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+}
+
+void BaseReloader::Reload(size_t number)
+{
+    try
+    {
+        std::shared_ptr<BaseGeneration> generation = LoadBaseGeneration(pars_, number);
+        SetReloadTrigger(*generation);
+        const double load_time_ms = generation->load_time_ms;
+
+        // запросы, уже получившие старое поколение, дорабатывают с ним
+        current_.Reset(std::move(generation));
+        log_ << "Base generation " << number << " loaded in " << load_time_ms << " ms" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        log_ << "Base generation " << number << " failed to load: " << e.what() << std::endl;
+    }
+    reloading_ = false;
+}
+
+void BaseReloader::SetReloadTrigger(BaseGeneration& generation)
+{
+    generation.handler->SetReloadTrigger([this]
+    {
+        const bool started = StartReload();
+        const std::shared_ptr<const BaseGeneration> current = GetCurrent();
+        return ReqHandler::BaseGenerationInfo{current->number, current->load_time_ms, started};
+    });
+}
+
+} // namespace TransportInformator::Service
+
+} // namespace TransportInformator
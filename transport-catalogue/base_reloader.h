@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "snapshot_holder.h"
+
+/*
+ * Загрузка базы, построенной make_base, и её перезагрузка в долгоживущем процессе.
+ * Каждое поколение базы содержит собственные справочник, маршрутизатор, визуализатор
+ * и обработчик запросов. Запросы, начатые на старом поколении, дорабатывают с ним,
+ * а память поколения освобождается вместе с последней ссылкой на него.
+ */
+
+namespace TransportInformator
+{
+
+namespace Service
+{
+
+struct BaseGeneration
+{
+    size_t number = 0;
+    double load_time_ms = 0;
+
+    // порядок полей важен: каждый следующий объект ссылается на предыдущие
+    std::shared_ptr<const Core::TransportCatalogue> catalogue;
+    std::unique_ptr<Router::TransportRouter> router;
+    std::unique_ptr<Render::MapRenderer> renderer;
+    std::unique_ptr<ReqHandler::RequestHandler> handler;
+};
+
+// Загружает базу из файла и собирает из неё поколение с заданным номером.
+// Если карта не была отрисована при make_base, она отрисовывается здесь один раз.
+std::shared_ptr<BaseGeneration> LoadBaseGeneration(const Serialize::SerializationParameters& pars, size_t number);
+
+class BaseReloader
+{
+    public:
+    // Синхронно загружает первое поколение базы
+    explicit BaseReloader(Serialize::SerializationParameters pars, std::ostream& log = std::cerr);
+    ~BaseReloader();
+
+    BaseReloader(const BaseReloader&) = delete;
+    BaseReloader& operator=(const BaseReloader&) = delete;
+
+    std::shared_ptr<const BaseGeneration> GetCurrent() const;
+
+    // Запускает загрузку нового поколения в фоновом потоке; false, если загрузка уже идёт.
+    // При ошибке загрузки продолжает работать текущее поколение.
+    bool StartReload();
+
+    // Дожидается окончания фоновой загрузки, если она идёт
+    void WaitReload();
+
+    private:
+    void Reload(size_t number);
+    void SetReloadTrigger(BaseGeneration& generation);
+
+    Serialize::SerializationParameters pars_;
+    std::ostream& log_;
+
+    SnapshotHolder<BaseGeneration> current_;
+
+    std::mutex worker_mutex_;
+    std::thread worker_;
+    std::atomic<bool> reloading_{false};
+};
+
+} // namespace TransportInformator::Service
+
+} // namespace TransportInformator
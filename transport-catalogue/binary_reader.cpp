@@ -0,0 +1,272 @@
+#include "binary_reader.h"
+#include <stat_requests.pb.h>
+
+#include <sstream>
+#include <stdexcept>
+
+namespace TransportInformator
+{
+
+namespace Input
+{
+    void BusInfoRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        auto info = rh.GetBusStat(name);
+        if (!info.has_value())
+        {
+            response.set_error_message("not found");
+            return;
+        }
+
+        stat_serialization::BusStat& stat = *response.mutable_bus();
+        stat.set_route_length(info->route_length);
+        stat.set_curvature(info->curvature);
+        stat.set_stop_count(static_cast<int>(info->stops));
+        stat.set_unique_stop_count(static_cast<int>(info->unique_stops));
+    }
+
+    void StopInfoRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        auto info = rh.GetStopStat(name);
+        if (!info.has_value())
+        {
+            response.set_error_message("not found");
+            return;
+        }
+
+        stat_serialization::StopStat& stat = *response.mutable_stop();
+        stat.mutable_buses()->Reserve(static_cast<int>(info->buses.size()));
+        for (std::string_view bus : info->buses)
+        {
+            stat.add_buses(bus.data(), bus.size());
+        }
+    }
+
+    void MapRenderRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        if (rh.HasRenderedMap())
+        {
+            response.set_map(*rh.GetRenderedMap());
+            return;
+        }
+        response.set_map(rh.RenderMapSvg());
+    }
+
+    void MapTileRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        std::ostringstream out;
+        rh.RenderMapTile(viewport, out);
+        response.set_map(out.str());
+    }
+
+    void RouteRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        std::optional<Router::Route> built_route = rh.BuildRoute(from, to);
+        if (!built_route.has_value() || built_route.value().total_time == -1)
+        {
+            response.set_error_message("not found");
+            return;
+        }
+
+        stat_serialization::RouteInfo& route = *response.mutable_route();
+        route.set_total_time(built_route.value().total_time);
+        route.mutable_items()->Reserve(static_cast<int>(built_route.value().route_details.size()));
+        for (auto& route_element : built_route.value().route_details)
+        {
+            stat_serialization::RouteItem& item = *route.add_items();
+            if (auto* wait = std::get_if<Router::Route::RouteElementWait>(&route_element))
+            {
+                stat_serialization::RouteWaitItem& wait_item = *item.mutable_wait();
+                wait_item.set_stop_name(std::move(wait->stop_name));
+                wait_item.set_time(wait->time);
+                continue;
+            }
+            auto& bus = std::get<Router::Route::RouteElementBus>(route_element);
+            stat_serialization::RouteBusItem& bus_item = *item.mutable_bus();
+            bus_item.set_bus(std::move(bus.bus));
+            bus_item.set_span_count(bus.span_count);
+            bus_item.set_time(bus.time);
+        }
+    }
+
+    void RouteMapRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        std::optional<Router::Route> built_route = rh.BuildRoute(from, to);
+        if (!built_route.has_value() || built_route.value().total_time == -1)
+        {
+            response.set_error_message("not found");
+            return;
+        }
+
+        std::ostringstream out;
+        rh.RenderRouteMap(built_route.value(), to, out);
+        response.set_map(out.str());
+    }
+
+    void NearestStopsRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        const std::vector<Core::NearbyStop> stops = rh.GetNearestStops(center, radius, count);
+
+        stat_serialization::NearestStops& nearest = *response.mutable_nearest_stops();
+        nearest.mutable_stops()->Reserve(static_cast<int>(stops.size()));
+        for (const Core::NearbyStop& stop : stops)
+        {
+            stat_serialization::NearbyStop& nearby = *nearest.add_stops();
+            nearby.set_name(stop.name.data(), stop.name.size());
+            nearby.set_distance(stop.distance);
+        }
+    }
+
+    void ReloadRequest::ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        std::optional<ReqHandler::BaseGenerationInfo> info = rh.Reload();
+        if (!info.has_value())
+        {
+            response.set_error_message("reload is not supported");
+            return;
+        }
+
+        stat_serialization::ReloadInfo& reload = *response.mutable_reload();
+        reload.set_generation(static_cast<int>(info->generation));
+        reload.set_load_time(info->load_time_ms);
+        reload.set_reload_started(info->reload_started);
+    }
+
+    void InvalidRequest::ProcessBinary([[maybe_unused]] ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response)
+    {
+        response.set_error_message(error_message);
+    }
+
+    BinaryReader::BinaryReader(std::istream& in) : in_{in} {}
+
+    void BinaryReader::ReadProcessRequests()
+    {
+        stat_serialization::StatRequests requests;
+        if (!requests.ParseFromIstream(&in_))
+        {
+            throw std::invalid_argument("Can't parse binary stat requests");
+        }
+
+        serialization_settings_.file = std::move(*requests.mutable_serialization_file());
+        stat_requests_.reserve(stat_requests_.size() + requests.requests_size());
+        for (const stat_serialization::StatRequest& request : requests.requests())
+        {
+            AddStatRequest(request);
+        }
+    }
+
+    Serialize::SerializationParameters BinaryReader::GetSerializationSettings() const
+    {
+        return serialization_settings_;
+    }
+
+    StatBatchStats BinaryReader::GetLastBatchStats() const
+    {
+        return last_batch_stats_;
+    }
+
+    void BinaryReader::SendStatRequests(ReqHandler::RequestHandler& rh, std::ostream& out)
+    {
+        // повторяющиеся запросы получают копию ответа на первый такой же запрос
+        const std::vector<size_t> first = FindRepeatedRequests(stat_requests_);
+        last_batch_stats_ = {stat_requests_.size(), 0};
+
+        stat_serialization::StatResponses responses;
+        responses.mutable_responses()->Reserve(static_cast<int>(stat_requests_.size()));
+        for (size_t i = 0; i < stat_requests_.size(); ++i)
+        {
+            stat_serialization::StatResponse& response = *responses.add_responses();
+            if (first[i] == i)
+            {
+                ++last_batch_stats_.computed;
+                stat_requests_[i]->ProcessBinary(rh, response);
+            }
+            else
+            {
+                response = responses.responses(static_cast<int>(first[i]));
+            }
+            response.set_request_id(static_cast<int>(stat_requests_[i]->id));
+        }
+        stat_requests_.clear();
+
+        if (!responses.SerializeToOstream(&out))
+        {
+            throw std::runtime_error("Can't write binary stat responses");
+        }
+    }
+
+    // Параметры проверяются теми же Make*Request, что и у запросов из JSON
+    void BinaryReader::AddStatRequest(const stat_serialization::StatRequest& request)
+    {
+        const size_t id = static_cast<size_t>(request.id());
+        switch (request.request_case())
+        {
+        case stat_serialization::StatRequest::kBus:
+            stat_requests_.push_back(std::make_unique<BusInfoRequest>(id, StatRequestType::BUS, request.bus().name()));
+            break;
+        case stat_serialization::StatRequest::kStop:
+            stat_requests_.push_back(std::make_unique<StopInfoRequest>(id, StatRequestType::STOP, request.stop().name()));
+            break;
+        case stat_serialization::StatRequest::kMap:
+            stat_requests_.push_back(std::make_unique<MapRenderRequest>(id, StatRequestType::MAP));
+            break;
+        case stat_serialization::StatRequest::kRoute:
+            stat_requests_.push_back(std::make_unique<RouteRequest>(id, StatRequestType::ROUTE,
+                                                                    request.route().from(), request.route().to()));
+            break;
+        case stat_serialization::StatRequest::kRouteMap:
+            stat_requests_.push_back(std::make_unique<RouteMapRequest>(id, StatRequestType::ROUTE_MAP,
+                                                                       request.route_map().from(), request.route_map().to()));
+            break;
+        case stat_serialization::StatRequest::kNearestStops:
+        {
+            const stat_serialization::NearestStopsRequest& nearest = request.nearest_stops();
+            std::optional<double> radius;
+            if (nearest.has_radius())
+            {
+                radius = nearest.radius();
+            }
+            std::optional<int> count;
+            if (nearest.has_count())
+            {
+                count = nearest.count();
+            }
+            stat_requests_.push_back(MakeNearestStopsRequest(id, {nearest.latitude(), nearest.longitude()}, radius, count));
+            break;
+        }
+        case stat_serialization::StatRequest::kMapTile:
+        {
+            const stat_serialization::MapTileRequest& tile = request.map_tile();
+            Render::MapViewport viewport;
+            if (tile.has_tile())
+            {
+                viewport = Render::GetTileViewport(tile.tile().zoom(), tile.tile().x(), tile.tile().y());
+            }
+            else
+            {
+                const stat_serialization::BoundsArea& bounds = tile.bounds();
+                viewport.min = {bounds.min_latitude(), bounds.min_longitude()};
+                viewport.max = {bounds.max_latitude(), bounds.max_longitude()};
+            }
+            if (tile.has_width())
+            {
+                viewport.width = tile.width();
+            }
+            if (tile.has_height())
+            {
+                viewport.height = tile.height();
+            }
+            stat_requests_.push_back(MakeMapTileRequest(id, viewport));
+            break;
+        }
+        case stat_serialization::StatRequest::kReload:
+            stat_requests_.push_back(std::make_unique<ReloadRequest>(id, StatRequestType::RELOAD));
+            break;
+        default:
+            throw std::invalid_argument("Wrong stat request");
+        }
+    }
+
+} // namespace TransportInformator::Input
+
+} // namespace TransportInformator
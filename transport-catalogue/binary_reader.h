@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "json_reader.h"
+#include "request_handler.h"
+#include "serialization.h"
+
+/*
+ * Запросы к готовой базе в двоичном виде (stat_requests.proto) для программ-клиентов:
+ * ни разбора текста, ни форматирования чисел. Запросы читаются в те же классы StatRequest,
+ * что и из JSON, поэтому проверки запросов и ответы на них совпадают
+ */
+
+namespace stat_serialization
+{
+    class StatRequest;
+}
+
+namespace TransportInformator
+{
+
+namespace Input
+{
+    class BinaryReader
+    {
+    public:
+        explicit BinaryReader(std::istream& in);
+
+        // Читает весь ввод как одно сообщение StatRequests
+        void ReadProcessRequests();
+        Serialize::SerializationParameters GetSerializationSettings() const;
+        // Выводит ответы одним сообщением StatResponses и забывает прочитанные запросы
+        void SendStatRequests(ReqHandler::RequestHandler& rh, std::ostream& out);
+        // Повторы в пакете, на который в последний раз отвечал SendStatRequests
+        StatBatchStats GetLastBatchStats() const;
+
+    private:
+        void AddStatRequest(const stat_serialization::StatRequest& request);
+
+        std::istream& in_;
+        Serialize::SerializationParameters serialization_settings_;
+        std::vector<std::unique_ptr<StatRequest>> stat_requests_;
+        StatBatchStats last_batch_stats_;
+    };
+
+} // namespace TransportInformator::Input
+
+} // namespace TransportInformator
@@ -4,8 +4,10 @@
 #include <vector>
 #include <set>
 #include <string_view>
+#include <cstdint>
 
 #include "geo.h"
+#include "arena.h"
 
 /*
  * В этом файле вы можете разместить классы/структуры, которые являются частью предметной области (domain)
@@ -25,16 +27,19 @@ namespace TransportInformator
 namespace Core
 {
 
+// Имена и массивы остановок хранятся в арене справочника и живут вместе с ним
 struct Stop
 {
-    std::string name;
+    std::string_view name;
     detail::Coordinates coords;
+    // порядковый номер остановки в справочнике: остановки нумеруются подряд с нуля
+    uint32_t id;
 };
 
 struct Bus
 {
-    std::string name;
-    std::vector<const Stop*> stops;
+    std::string_view name;
+    detail::Span<const Stop*> stops;
     bool is_roundtrip;
 };
 
@@ -47,10 +52,17 @@ struct BusInfo
     double curvature;
 };
 
+// Маршруты не копируются: это ссылка на множество в справочнике, из которого взята остановка
 struct StopInfo
 {
     std::string_view name;
-    std::set<std::string_view> buses;
+    const std::set<std::string_view>& buses;
+};
+
+struct NearbyStop
+{
+    std::string_view name;
+    double distance;
 };
 
 } //namespace Core
@@ -2,6 +2,7 @@
 #include "geo.h"
 
 #include <cmath>
+#include <vector>
 
 namespace TransportInformator
 {
@@ -9,6 +10,11 @@ namespace TransportInformator
     namespace detail
     {
 
+        namespace
+        {
+            const double DEGREES_TO_RADIANS = 3.1415926535 / 180.;
+        }
+
         bool Coordinates::operator==(const Coordinates &other) const
         {
             return lat == other.lat && lng == other.lng;
@@ -25,9 +31,41 @@ namespace TransportInformator
             {
                 return 0;
             }
-            static const double dr = 3.1415926535 / 180.;
-            return acos(sin(from.lat * dr) * sin(to.lat * dr) + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr)) * 6371000;
+            const double dr = DEGREES_TO_RADIANS;
+            return acos(sin(from.lat * dr) * sin(to.lat * dr) + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr)) * EARTH_RADIUS;
+        }
+
+        void ComputeDistancesAlongPath(const Coordinates* points, size_t count, double* distances)
+        {
+            using namespace std;
+            if (count < 2)
+            {
+                return;
+            }
+
+            // Тригонометрия широты для каждой точки один раз, соседние отрезки её разделяют.
+            // Синусы и косинусы лежат в одном буфере: на вызов одно выделение памяти
+            vector<double> lat_trig(2 * count);
+            double* const lat_sin = lat_trig.data();
+            double* const lat_cos = lat_trig.data() + count;
+            for (size_t i = 0; i < count; ++i)
+            {
+                lat_sin[i] = sin(points[i].lat * DEGREES_TO_RADIANS);
+                lat_cos[i] = cos(points[i].lat * DEGREES_TO_RADIANS);
+            }
+
+            // Отдельные проходы выходят быстрее одного общего цикла
+            const size_t segments = count - 1;
+            for (size_t i = 0; i < segments; ++i)
+            {
+                distances[i] = cos(abs(points[i].lng - points[i + 1].lng) * DEGREES_TO_RADIANS);
+            }
+            for (size_t i = 0; i < segments; ++i)
+            {
+                distances[i] = points[i] == points[i + 1] ? 0
+                    : acos(lat_sin[i] * lat_sin[i + 1] + lat_cos[i] * lat_cos[i + 1] * distances[i]) * EARTH_RADIUS;
+            }
         }
     } // namespace detail
 
-} // namespace TransportInformator
\ No newline at end of file
+} // namespace TransportInformator
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 
 namespace TransportInformator
 {
 
     namespace detail
     {
+        inline const double EARTH_RADIUS = 6371000;
+
         struct Coordinates
         {
             double lat;
@@ -16,6 +19,11 @@ namespace TransportInformator
         };
 
         double ComputeDistance(Coordinates from, Coordinates to);
+
+        // distances[i] = ComputeDistance(points[i], points[i + 1]) для i < count - 1.
+        // Синус и косинус широты каждой точки считаются один раз, а не дважды, как при вызовах
+        // ComputeDistance для соседних отрезков; порядок операций тот же, поэтому результаты совпадают побитово
+        void ComputeDistancesAlongPath(const Coordinates* points, size_t count, double* distances);
     } // namespace detail
 
 } // namespace TransportInformator
\ No newline at end of file
@@ -1,111 +1,233 @@
 #include "json.h"
+#include "number_format.h"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
 #include <iterator>
+#include <new>
+#include <sstream>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace json {
 
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+// Словари до такого размера просматриваются подряд: на коротком массиве это быстрее двоичного поиска
+constexpr size_t LINEAR_SEARCH_LIMIT = 8;
+
+// Разбираемый текст: указатели cur и end ограничивают ещё не прочитанную часть текущего куска.
+// Текст, переданный целиком, — это один кусок. Поток читается кусками из его буфера, не дожидаясь
+// конца ввода, а прочитанный, но не разобранный остаток последнего куска возвращается потоку.
+class InputBuffer {
+public:
+    explicit InputBuffer(std::string_view text)
+        : cur(text.data())
+        , end(text.data() + text.size()) {
+    }
 
-std::string LoadLiteral(std::istream& input) {
-    std::string s;
-    while (std::isalpha(input.peek())) {
-        s.push_back(static_cast<char>(input.get()));
+    explicit InputBuffer(std::istream& input)
+        : input_(&input)
+        , chunk_(MAX_CHUNK_SIZE) {
     }
-    return s;
-}
 
-Node LoadArray(std::istream& input) {
-    std::vector<Node> result;
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
 
-    for (char c; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
+    ~InputBuffer() {
+        if (input_ == nullptr) {
+            return;
+        }
+        // Остаток лежит в буфере потока прямо перед текущей позицией, поэтому sungetc его возвращает
+        for (auto unread = end - cur; unread > 0; --unread) {
+            if (Traits::eq_int_type(input_->rdbuf()->sungetc(), Traits::eof())) {
+                input_->setstate(std::ios_base::badbit);
+                break;
+            }
         }
-        result.push_back(LoadNode(input));
     }
-    if (!input) {
-        throw ParsingError("Array parsing error"s);
+
+    // Есть ли ещё символы; при необходимости читает следующий кусок
+    bool HasMore() {
+        return cur != end || Refill();
+    }
+
+    const char* cur = nullptr;
+    const char* end = nullptr;
+
+private:
+    using Traits = std::char_traits<char>;
+    static constexpr std::streamsize MAX_CHUNK_SIZE = 64 * 1024;
+
+    bool Refill() {
+        if (input_ == nullptr) {
+            return false;
+        }
+        std::streambuf& buf = *input_->rdbuf();
+        if (Traits::eq_int_type(buf.sgetc(), Traits::eof())) {
+            input_->setstate(std::ios_base::eofbit);
+            return false;
+        }
+        // Забираем только то, что уже есть в буфере потока: чтение не ждёт следующих данных,
+        // а взятые символы можно вернуть. Поток без буфера отдаёт по одному символу
+        const std::streamsize size = buf.sgetn(chunk_.data(), std::clamp<std::streamsize>(buf.in_avail(), 1, MAX_CHUNK_SIZE));
+        cur = chunk_.data();
+        end = cur + size;
+        return size > 0;
     }
-    return Node(std::move(result));
+
+    std::istream* input_ = nullptr;
+    std::vector<char> chunk_;
+};
+
+bool IsSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
 }
 
-Node LoadDict(std::istream& input) {
-    Dict dict;
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
 
-    for (char c; input >> c && c != '}';) {
-        if (c == '"') {
-            std::string key = LoadString(input).AsString();
-            if (input >> c && c == ':') {
-                if (dict.find(key) != dict.end()) {
-                    throw ParsingError("Duplicate key '"s + key + "' have been found");
-                }
-                dict.emplace(std::move(key), LoadNode(input));
-            } else {
-                throw ParsingError(": is expected but '"s + c + "' has been found"s);
-            }
-        } else if (c != ',') {
-            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+// Первый символ в [begin, end), не являющийся пробельным, или end
+const char* SkipSpaces(const char* begin, const char* end) {
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i control_range = _mm_set1_epi8('\r' - '\t');
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        // символы от \t до \r: после вычитания \t беззнаковое значение не больше \r - \t
+        const __m128i shifted = _mm_sub_epi8(chunk, tab);
+        const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, control_range), shifted);
+        const __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), is_control);
+        const int not_space_mask = ~_mm_movemask_epi8(is_space) & 0xFFFF;
+        if (not_space_mask != 0) {
+            return begin + __builtin_ctz(not_space_mask);
         }
     }
-    if (!input) {
-        throw ParsingError("Dictionary parsing error"s);
+#endif
+    while (begin != end && IsSpace(*begin)) {
+        ++begin;
     }
-    return Node(std::move(dict));
+    return begin;
 }
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
+// Первый символ в [begin, end), на котором обычный текст строки прерывается: кавычка, \ или перевод строки
+const char* FindStringSpecial(const char* begin, const char* end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i line_feed = _mm_set1_epi8('\n');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+        const int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (begin != end && *begin != '"' && *begin != '\\' && *begin != '\n' && *begin != '\r') {
+        ++begin;
+    }
+    return begin;
+}
+
+// Аналог input >> c: пропускает пробельные символы и читает следующий
+bool ReadChar(InputBuffer& input, char& c) {
     while (true) {
-        if (it == end) {
-            throw ParsingError("String parsing error");
+        input.cur = SkipSpaces(input.cur, input.end);
+        if (input.cur != input.end) {
+            c = *input.cur++;
+            return true;
         }
-        const char ch = *it;
-        if (ch == '"') {
-            ++it;
-            break;
-        } else if (ch == '\\') {
-            ++it;
-            if (it == end) {
+        if (!input.HasMore()) {
+            return false;
+        }
+    }
+}
+
+// Символ только что прочитан ReadChar из текущего куска, поэтому его можно вернуть
+void PutBack(InputBuffer& input) {
+    --input.cur;
+}
+
+// Аналог input.peek(): следующий символ или EOF
+int PeekChar(InputBuffer& input) {
+    return input.HasMore() ? static_cast<unsigned char>(*input.cur) : std::char_traits<char>::eof();
+}
+
+std::string LoadLiteral(InputBuffer& input) {
+    std::string s;
+    while (std::isalpha(PeekChar(input))) {
+        s.push_back(*input.cur++);
+    }
+    return s;
+}
+
+// Читает строку в буфер s и возвращает её текст; буфер переиспользуется между строками
+std::string_view LoadStringValue(InputBuffer& input, std::string& s) {
+    s.clear();
+    while (true) {
+        // обычный текст до ближайшего особого символа копируется целиком
+        const char* special = FindStringSpecial(input.cur, input.end);
+        s.append(input.cur, special);
+        input.cur = special;
+        if (special == input.end) {
+            if (!input.HasMore()) {
                 throw ParsingError("String parsing error");
             }
-            const char escaped_char = *(it);
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
-            }
-        } else if (ch == '\n' || ch == '\r') {
+            continue;
+        }
+
+        // ошибочный символ, как и раньше, остаётся непрочитанным
+        const char ch = *input.cur;
+        if (ch == '\n' || ch == '\r') {
             throw ParsingError("Unexpected end of line"s);
-        } else {
-            s.push_back(ch);
         }
-        ++it;
+        ++input.cur;
+        if (ch == '"') {
+            break;
+        }
+        if (!input.HasMore()) {
+            throw ParsingError("String parsing error");
+        }
+        const char escaped_char = *input.cur;
+        switch (escaped_char) {
+            case 'n':
+                s.push_back('\n');
+                break;
+            case 't':
+                s.push_back('\t');
+                break;
+            case 'r':
+                s.push_back('\r');
+                break;
+            case '"':
+                s.push_back('"');
+                break;
+            case '\\':
+                s.push_back('\\');
+                break;
+            default:
+                throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+        }
+        ++input.cur;
     }
 
-    return Node(std::move(s));
+    return s;
 }
 
-Node LoadBool(std::istream& input) {
+Node LoadBool(InputBuffer& input) {
     const auto s = LoadLiteral(input);
     if (s == "true"sv) {
         return Node{true};
@@ -116,7 +238,7 @@ Node LoadBool(std::istream& input) {
     }
 }
 
-Node LoadNull(std::istream& input) {
+Node LoadNull(InputBuffer& input) {
     if (auto literal = LoadLiteral(input); literal == "null"sv) {
         return Node{nullptr};
     } else {
@@ -124,33 +246,64 @@ Node LoadNull(std::istream& input) {
     }
 }
 
-Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
+// Преобразует текст числа, уже проверенный грамматикой JSON, без промежуточных строк и без локали
+Node ConvertNumber(std::string_view text, bool is_int) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (is_int) {
+        int value = 0;
+        if (const auto [ptr, error] = std::from_chars(first, last, value); error == std::errc{} && ptr == last) {
+            return value;
+        }
+        // При переполнении int число читается как double
+    }
+    double value = 0.0;
+    const auto [ptr, error] = std::from_chars(first, last, value);
+    // Денормализованные значения отвергаются, как это делал std::stod
+    if (error != std::errc{} || ptr != last || std::fpclassify(value) == FP_SUBNORMAL) {
+        throw ParsingError("Failed to convert "s + std::string(text) + " to number"s);
+    }
+    return value;
+}
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw ParsingError("Failed to read number from stream"s);
+Node LoadNumber(InputBuffer& input) {
+    // Число разбирается прямо в куске ввода. Если оно не уместилось в кусок,
+    // уже прочитанное начало переносится в spilled перед чтением следующего куска
+    const char* start = input.cur;
+    std::string spilled;
+
+    auto has_more = [&] {
+        if (input.cur != input.end) {
+            return true;
         }
+        spilled.append(start, input.cur);
+        const bool result = input.HasMore();
+        start = input.cur;
+        return result;
+    };
+
+    auto peek_char = [&]() -> int {
+        return has_more() ? static_cast<unsigned char>(*input.cur) : std::char_traits<char>::eof();
     };
 
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
+    // Пропускает одну или более цифр
+    auto read_digits = [&] {
+        if (!has_more() || !IsDigit(*input.cur)) {
             throw ParsingError("A digit is expected"s);
         }
-        while (std::isdigit(input.peek())) {
-            read_char();
-        }
+        do {
+            while (input.cur != input.end && IsDigit(*input.cur)) {
+                ++input.cur;
+            }
+        } while (has_more() && IsDigit(*input.cur));
     };
 
-    if (input.peek() == '-') {
-        read_char();
+    if (peek_char() == '-') {
+        ++input.cur;
     }
     // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
+    if (peek_char() == '0') {
+        ++input.cur;
         // После 0 в JSON не могут идти другие цифры
     } else {
         read_digits();
@@ -158,125 +311,316 @@ Node LoadNumber(std::istream& input) {
 
     bool is_int = true;
     // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
+    if (peek_char() == '.') {
+        ++input.cur;
         read_digits();
         is_int = false;
     }
 
     // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+    if (int ch = peek_char(); ch == 'e' || ch == 'E') {
+        ++input.cur;
+        if (ch = peek_char(); ch == '+' || ch == '-') {
+            ++input.cur;
         }
         read_digits();
         is_int = false;
     }
 
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении
-                // код ниже попробует преобразовать строку в double
+    if (spilled.empty()) {
+        return ConvertNumber(std::string_view(start, input.cur - start), is_int);
+    }
+    spilled.append(start, input.cur);
+    return ConvertNumber(spilled, is_int);
+}
+
+// Разбирает документ в арену. Элементы массивов и словарей сначала копятся в общих для всего
+// разбора стеках и переносятся в арену одним блоком, когда их число уже известно:
+// так в арене не остаются буферы, брошенные при росте векторов.
+class Parser {
+public:
+    Parser(InputBuffer& input, std::pmr::memory_resource& arena)
+        : input_(input)
+        , arena_(&arena) {
+    }
+
+    // Разбирает узел и размещает его самого в арене
+    Node* LoadRoot() {
+        void* place = arena_->allocate(sizeof(Node), alignof(Node));
+        return new (place) Node(LoadNode());
+    }
+
+private:
+    Node LoadNode() {
+        char c;
+        if (!ReadChar(input_, c)) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        switch (c) {
+            case '[':
+                return LoadArray();
+            case '{':
+                return LoadDict();
+            case '"':
+                return Node(LoadString());
+            case 't':
+                // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
+                // подсказкой компилятору и человеку, что здесь программист явно задумывал
+                // разрешить переход к инструкции следующей ветки case, а не случайно забыл
+                // написать break, return или throw.
+                // В данном случае, встретив t или f, переходим к попытке парсинга
+                // литералов true либо false
+                [[fallthrough]];
+            case 'f':
+                PutBack(input_);
+                return LoadBool(input_);
+            case 'n':
+                PutBack(input_);
+                return LoadNull(input_);
+            default:
+                PutBack(input_);
+                return LoadNumber(input_);
+        }
+    }
+
+    Node LoadArray() {
+        // вложенные массивы кладут свои элементы выше и убирают их до возврата
+        const size_t first = array_items_.size();
+
+        char c;
+        bool has_char;
+        while ((has_char = ReadChar(input_, c)) && c != ']') {
+            if (c != ',') {
+                PutBack(input_);
             }
+            array_items_.push_back(LoadNode());
         }
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+        if (!has_char) {
+            throw ParsingError("Array parsing error"s);
+        }
+
+        const auto items_begin = array_items_.begin() + first;
+        Array result(arena_);
+        result.reserve(array_items_.end() - items_begin);
+        std::move(items_begin, array_items_.end(), std::back_inserter(result));
+        array_items_.erase(items_begin, array_items_.end());
+        return Node(std::move(result));
     }
-}
 
-Node LoadNode(std::istream& input) {
-    char c;
-    if (!(input >> c)) {
-        throw ParsingError("Unexpected EOF"s);
+    Node LoadDict() {
+        const size_t first = dict_items_.size();
+
+        char c;
+        bool has_char;
+        while ((has_char = ReadChar(input_, c)) && c != '}') {
+            if (c == '"') {
+                String key(LoadStringValue(input_, string_buffer_), arena_);
+                if (ReadChar(input_, c) && c == ':') {
+                    // пары дописываются в порядке ввода и упорядочиваются одной сортировкой в конце словаря
+                    Node value = LoadNode();
+                    dict_items_.emplace_back(std::move(key), std::move(value));
+                } else {
+                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+            } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        if (!has_char) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+
+        const auto items_begin = dict_items_.begin() + first;
+        std::sort(items_begin, dict_items_.end(), [](const Dict::value_type& lhs, const Dict::value_type& rhs) {
+            return std::string_view(lhs.first) < std::string_view(rhs.first);
+        });
+        const auto duplicate = std::adjacent_find(items_begin, dict_items_.end(),
+                                                  [](const Dict::value_type& lhs, const Dict::value_type& rhs) {
+                                                      return lhs.first == rhs.first;
+                                                  });
+        if (duplicate != dict_items_.end()) {
+            throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+        }
+
+        Dict result(arena_);
+        result.reserve(dict_items_.end() - items_begin);
+        result.insert(std::make_move_iterator(items_begin), std::make_move_iterator(dict_items_.end()));
+        dict_items_.erase(items_begin, dict_items_.end());
+        return Node(std::move(result));
     }
-    switch (c) {
-        case '[':
-            return LoadArray(input);
-        case '{':
-            return LoadDict(input);
-        case '"':
-            return LoadString(input);
-        case 't':
-            // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-            // подсказкой компилятору и человеку, что здесь программист явно задумывал
-            // разрешить переход к инструкции следующей ветки case, а не случайно забыл
-            // написать break, return или throw.
-            // В данном случае, встретив t или f, переходим к попытке парсинга
-            // литералов true либо false
-            [[fallthrough]];
-        case 'f':
-            input.putback(c);
-            return LoadBool(input);
-        case 'n':
-            input.putback(c);
-            return LoadNull(input);
-        default:
-            input.putback(c);
-            return LoadNumber(input);
+
+    String LoadString() {
+        return String(LoadStringValue(input_, string_buffer_), arena_);
     }
-}
+
+    InputBuffer& input_;
+    std::pmr::memory_resource* arena_;
+
+    std::vector<Node> array_items_;
+    std::vector<Dict::value_type> dict_items_;
+    std::string string_buffer_;
+};
+
+// Собирает выводимый текст в большой буфер и передаёт его потоку крупными кусками,
+// а не отдельными символами и короткими строками
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::ostream& out)
+        : out_(out)
+        , plain_numbers_(TransportInformator::detail::HasPlainNumberFormat(out))
+        , precision_(static_cast<int>(out.precision())) {
+        buffer_.reserve(CAPACITY);
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void Put(char c) {
+        buffer_.push_back(c);
+        FlushIfFull();
+    }
+
+    void Write(std::string_view text) {
+        // крупный текст, например карта, передаётся потоку сразу, без копирования в буфер
+        if (text.size() >= CAPACITY) {
+            Flush();
+            out_.write(text.data(), text.size());
+            return;
+        }
+        buffer_.append(text);
+        FlushIfFull();
+    }
+
+    void WriteNumber(int value) {
+        if (!plain_numbers_) {
+            Flush();
+            TransportInformator::detail::WriteNumber(out_, value);
+            return;
+        }
+        char number[TransportInformator::detail::MAX_NUMBER_LENGTH];
+        Write({number, static_cast<size_t>(TransportInformator::detail::FormatNumber(number, value) - number)});
+    }
+
+    void WriteNumber(double value) {
+        if (!plain_numbers_) {
+            Flush();
+            TransportInformator::detail::WriteNumber(out_, value);
+            return;
+        }
+        char number[TransportInformator::detail::MAX_NUMBER_LENGTH];
+        Write({number, static_cast<size_t>(TransportInformator::detail::FormatNumber(number, value, precision_) - number)});
+    }
+
+    void Flush() {
+        out_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+private:
+    static constexpr size_t CAPACITY = 1 << 20;
+
+    void FlushIfFull() {
+        if (buffer_.size() >= CAPACITY) {
+            Flush();
+        }
+    }
+
+    std::ostream& out_;
+    // числа форматируются в буфере, если поток вывел бы их так же
+    bool plain_numbers_;
+    int precision_;
+    std::string buffer_;
+};
 
 struct PrintContext {
-    std::ostream& out;
+    OutputBuffer& out;
+    bool compact = false;
     int indent_step = 4;
     int indent = 0;
 
     void PrintIndent() const {
         for (int i = 0; i < indent; ++i) {
-            out.put(' ');
+            out.Put(' ');
         }
     }
 
     PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+        return {out, compact, indent_step, indent_step + indent};
     }
 };
 
 void PrintNode(const Node& value, const PrintContext& ctx);
 
 template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
+void PrintValue(const Value& value, const PrintContext& ctx);
+
+// Возвращает замену символа внутри строки JSON или пустую строку, если символ выводится как есть
+std::string_view GetEscapeSequence(char c) {
+    switch (c) {
+        case '\r':
+            return "\\r"sv;
+        case '\n':
+            return "\\n"sv;
+        // Символы " и \ выводятся как \" или \\, соответственно
+        case '"':
+            return "\\\""sv;
+        case '\\':
+            return "\\\\"sv;
+        default:
+            return {};
+    }
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
+void AppendEscaped(std::string_view value, std::string& target) {
     for (const char c : value) {
-        switch (c) {
-            case '\r':
-                out << "\\r"sv;
-                break;
-            case '\n':
-                out << "\\n"sv;
-                break;
-            case '"':
-                // Символы " и \ выводятся как \" или \\, соответственно
-                [[fallthrough]];
-            case '\\':
-                out.put('\\');
-                [[fallthrough]];
-            default:
-                out.put(c);
-                break;
+        const std::string_view escaped = GetEscapeSequence(c);
+        if (escaped.empty()) {
+            target.push_back(c);
+        } else {
+            target.append(escaped);
+        }
+    }
+}
+
+void PrintString(std::string_view value, OutputBuffer& out) {
+    out.Put('"');
+    // текст между символами, требующими экранирования, выводится целиком
+    size_t run_begin = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        const std::string_view escaped = GetEscapeSequence(value[i]);
+        if (!escaped.empty()) {
+            out.Write(value.substr(run_begin, i - run_begin));
+            out.Write(escaped);
+            run_begin = i + 1;
         }
     }
-    out.put('"');
+    out.Write(value.substr(run_begin));
+    out.Put('"');
 }
 
 template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
+void PrintValue<int>(const int& value, const PrintContext& ctx) {
+    ctx.out.WriteNumber(value);
+}
+
+template <>
+void PrintValue<double>(const double& value, const PrintContext& ctx) {
+    ctx.out.WriteNumber(value);
+}
+
+template <>
+void PrintValue<String>(const String& value, const PrintContext& ctx) {
     PrintString(value, ctx.out);
 }
 
+template <>
+void PrintValue<RawJson>(const RawJson& value, const PrintContext& ctx) {
+    ctx.out.Write(*value.text);
+}
+
 template <>
 void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-    ctx.out << "null"sv;
+    ctx.out.Write("null"sv);
 }
 
 // В специализаци шаблона PrintValue для типа bool параметр value передаётся
@@ -285,49 +629,79 @@ void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx)
 // void PrintValue(bool value, const PrintContext& ctx);
 template <>
 void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-    ctx.out << (value ? "true"sv : "false"sv);
+    ctx.out.Write(value ? "true"sv : "false"sv);
 }
 
 template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "[\n"sv;
+    OutputBuffer& out = ctx.out;
+    if (ctx.compact) {
+        out.Put('[');
+        bool first = true;
+        for (const Node& node : nodes) {
+            if (!first) {
+                out.Put(',');
+            }
+            first = false;
+            PrintNode(node, ctx);
+        }
+        out.Put(']');
+        return;
+    }
+
+    out.Write("[\n"sv);
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const Node& node : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            out.Write(",\n"sv);
         }
         inner_ctx.PrintIndent();
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    out.Put('\n');
     ctx.PrintIndent();
-    out.put(']');
+    out.Put(']');
 }
 
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "{\n"sv;
+    OutputBuffer& out = ctx.out;
+    if (ctx.compact) {
+        out.Put('{');
+        bool first = true;
+        for (const auto& [key, node] : nodes) {
+            if (!first) {
+                out.Put(',');
+            }
+            first = false;
+            PrintString(key, out);
+            out.Put(':');
+            PrintNode(node, ctx);
+        }
+        out.Put('}');
+        return;
+    }
+
+    out.Write("{\n"sv);
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const auto& [key, node] : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            out.Write(",\n"sv);
         }
         inner_ctx.PrintIndent();
-        PrintString(key, ctx.out);
-        out << ": "sv;
+        PrintString(key, out);
+        out.Write(": "sv);
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    out.Put('\n');
     ctx.PrintIndent();
-    out.put('}');
+    out.Put('}');
 }
 
 void PrintNode(const Node& node, const PrintContext& ctx) {
@@ -340,12 +714,219 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
 
 }  // namespace
 
+Dict::Dict(const allocator_type& alloc)
+    : items_(alloc) {
+}
+
+Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+    if (items_.size() <= LINEAR_SEARCH_LIMIT) {
+        auto it = items_.begin();
+        while (it != items_.end() && std::string_view(it->first) < key) {
+            ++it;
+        }
+        return it;
+    }
+    return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+        return std::string_view(item.first) < key;
+    });
+}
+
+Dict::const_iterator Dict::find(std::string_view key) const {
+    const auto position = LowerBound(key);
+    return position != items_.end() && position->first == key ? position : items_.end();
+}
+
+size_t Dict::count(std::string_view key) const {
+    return find(key) != items_.end() ? 1 : 0;
+}
+
+const Node& Dict::at(std::string_view key) const {
+    const auto position = find(key);
+    if (position == items_.end()) {
+        throw std::out_of_range("Key '"s + std::string(key) + "' is not found"s);
+    }
+    return position->second;
+}
+
+Node& Dict::at(std::string_view key) {
+    return const_cast<Node&>(std::as_const(*this).at(key));
+}
+
+Node& Dict::operator[](std::string_view key) {
+    auto position = items_.begin() + (LowerBound(key) - items_.begin());
+    if (position == items_.end() || position->first != key) {
+        position = items_.emplace(position, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+    }
+    return position->second;
+}
+
+std::pair<Dict::const_iterator, bool> Dict::emplace(String key, Node value) {
+    const auto position = LowerBound(key);
+    if (position != items_.end() && position->first == key) {
+        return {position, false};
+    }
+    return {items_.emplace(position, std::move(key), std::move(value)), true};
+}
+
+void Dict::SortAppended(size_t old_size) {
+    const auto key_less = [](const value_type& lhs, const value_type& rhs) {
+        return std::string_view(lhs.first) < std::string_view(rhs.first);
+    };
+    // дописанные ключи строго возрастают и больше прежних: порядок уже верный
+    const auto check_from = items_.begin() + (old_size == 0 ? 0 : old_size - 1);
+    if (std::adjacent_find(check_from, items_.end(), [&key_less](const value_type& lhs, const value_type& rhs) {
+            return !key_less(lhs, rhs);
+        }) == items_.end()) {
+        return;
+    }
+    // устойчивая сортировка ставит первыми прежнюю пару и первую из дописанных с тем же ключом
+    std::stable_sort(items_.begin(), items_.end(), key_less);
+    items_.erase(std::unique(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) {
+                     return lhs.first == rhs.first;
+                 }),
+                 items_.end());
+}
+
+bool Dict::operator==(const Dict& rhs) const {
+    return items_ == rhs.items_;
+}
+
 Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+    // как и при чтении через operator>>: связанный поток вывода сбрасывается, испорченный поток не читается
+    const std::istream::sentry sentry(input, true);
+    if (!sentry) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    auto arena = std::make_unique<Document::Arena>();
+    InputBuffer buffer(input);
+    Node* root = Parser(buffer, *arena).LoadRoot();
+    return Document(std::move(arena), root);
+}
+
+Document Load(std::string_view text) {
+    auto arena = std::make_unique<Document::Arena>();
+    InputBuffer buffer(text);
+    Node* root = Parser(buffer, *arena).LoadRoot();
+    Document result(std::move(arena), root);
+    buffer.cur = SkipSpaces(buffer.cur, buffer.end);
+    if (buffer.cur != buffer.end) {
+        throw ParsingError("Unexpected data after JSON document"s);
+    }
+    return result;
+}
+
+void Print(const Document& doc, std::ostream& output, PrintStyle style) {
+    Print(doc.GetRoot(), output, style);
+}
+
+void Print(const Node& node, std::ostream& output, PrintStyle style) {
+    OutputBuffer buffer(output);
+    PrintNode(node, PrintContext{buffer, style == PrintStyle::COMPACT});
+    buffer.Flush();
+}
+
+// Повторяет вывод PrintValue<Array>, получая элементы по одному
+struct ArrayPrinter::Impl {
+    explicit Impl(std::ostream& output, PrintStyle style)
+        : buffer(output)
+        , ctx{buffer, style == PrintStyle::COMPACT} {
+    }
+
+    OutputBuffer buffer;
+    PrintContext ctx;
+    bool first = true;
+    bool finished = false;
+};
+
+ArrayPrinter::ArrayPrinter(std::ostream& output, PrintStyle style)
+    : impl_(std::make_unique<Impl>(output, style)) {
+    impl_->buffer.Write(impl_->ctx.compact ? "["sv : "[\n"sv);
+}
+
+ArrayPrinter::~ArrayPrinter() {
+    if (impl_->finished) {
+        return;
+    }
+    // деструктор может работать при раскрутке стека, поэтому ошибка записи здесь не выбрасывается
+    try {
+        impl_->buffer.Flush();
+    } catch (...) {
+    }
+}
+
+void ArrayPrinter::Print(const Node& item) {
+    const PrintContext& ctx = impl_->ctx;
+    if (!impl_->first) {
+        ctx.out.Write(ctx.compact ? ","sv : ",\n"sv);
+    }
+    impl_->first = false;
+    if (ctx.compact) {
+        PrintNode(item, ctx);
+        return;
+    }
+    const PrintContext inner_ctx = ctx.Indented();
+    inner_ctx.PrintIndent();
+    PrintNode(item, inner_ctx);
+}
+
+void ArrayPrinter::Finish() {
+    OutputBuffer& out = impl_->buffer;
+    if (!impl_->ctx.compact) {
+        out.Put('\n');
+        impl_->ctx.PrintIndent();
+    }
+    out.Put(']');
+    out.Flush();
+    impl_->finished = true;
+}
+
+RawJson MakeEscapedString(std::string_view value) {
+    std::string result;
+    result.reserve(value.size() + 2);
+    result.push_back('"');
+    AppendEscaped(value, result);
+    result.push_back('"');
+    return RawJson{std::make_shared<const std::string>(std::move(result))};
+}
+
+RawJson MakeEscapedString(const std::function<void(std::ostream&)>& write) {
+    std::string result;
+    result.push_back('"');
+    {
+        EscapingStringBuf buf{result};
+        std::ostream out{&buf};
+        write(out);
+    }
+    result.push_back('"');
+    return RawJson{std::make_shared<const std::string>(std::move(result))};
+}
+
+EscapingStringBuf::EscapingStringBuf(std::string& target)
+    : target_(target) {
+    setp(buffer_, buffer_ + sizeof(buffer_));
+}
+
+EscapingStringBuf::~EscapingStringBuf() {
+    Flush();
+}
+
+EscapingStringBuf::int_type EscapingStringBuf::overflow(int_type ch) {
+    Flush();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int EscapingStringBuf::sync() {
+    Flush();
+    return 0;
 }
 
-void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+void EscapingStringBuf::Flush() {
+    AppendEscaped({pbase(), static_cast<size_t>(pptr() - pbase())}, target_);
+    setp(buffer_, buffer_ + sizeof(buffer_));
 }
 
 }  // namespace json
\ No newline at end of file
@@ -1,29 +1,105 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
+#include <streambuf>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+// Строки и массивы получают память от полиморфного аллокатора: узлы документа, прочитанного Load,
+// лежат в его арене, а узлы, собранные в программе, и копии любых узлов — в обычной куче
+using String = std::pmr::string;
+using Array = std::pmr::vector<Node>;
+
+// Словарь — плоский массив пар, упорядоченный по ключу, как std::map.
+// Небольшие словари (а в запросах почти все словари небольшие) просматриваются подряд, крупные — двоичным поиском
+class Dict {
+public:
+    using value_type = std::pair<String, Node>;
+    using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+    Dict() = default;
+    explicit Dict(const allocator_type& alloc);
+
+    size_t size() const {
+        return items_.size();
+    }
+    bool empty() const {
+        return items_.empty();
+    }
+    void reserve(size_t size) {
+        items_.reserve(size);
+    }
+    allocator_type get_allocator() const {
+        return items_.get_allocator();
+    }
+
+    const_iterator begin() const {
+        return items_.begin();
+    }
+    const_iterator end() const {
+        return items_.end();
+    }
+
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    // Как и у std::map, при отсутствии ключа выбрасывают std::out_of_range
+    const Node& at(std::string_view key) const;
+    Node& at(std::string_view key);
+    // operator[] и emplace вставляют по одной паре со сдвигом хвоста, то есть за O(size()):
+    // они для небольших словарей, которые собираются по ключу (ответы на запросы, Builder)
+    Node& operator[](std::string_view key);
+    // Добавляет пару, если такого ключа ещё нет
+    std::pair<const_iterator, bool> emplace(String key, Node value);
+    // Добавляет пары из [first, last), как insert у std::map: из пар с одинаковым ключом остаётся первая,
+    // а уже имеющийся ключ не меняется. Пары дописываются в конец и упорядочиваются одной сортировкой;
+    // уже упорядоченные пары с ключами больше имеющихся просто дописываются
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last);
+
+    bool operator==(const Dict& rhs) const;
+
+private:
+    // Первый элемент с ключом не меньше key
+    const_iterator LowerBound(std::string_view key) const;
+    // Упорядочивает пары, дописанные в items_ начиная с old_size, вместе с прежними
+    void SortAppended(size_t old_size);
+
+    std::pmr::vector<value_type> items_;
+};
 
 class ParsingError : public std::runtime_error {
 public:
     using runtime_error::runtime_error;
 };
 
+// Фрагмент JSON, уже готовый к выводу (например, заранее экранированная строка).
+// Печатается как есть; текст хранится в общем буфере, поэтому копии узла его не копируют.
+struct RawJson {
+    std::shared_ptr<const std::string> text;
+
+    bool operator==(const RawJson& rhs) const {
+        return *text == *rhs.text;
+    }
+};
+
 class Node final
-    : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+    : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, String, RawJson> {
 public:
     using variant::variant;
     using Value = variant;
 
     Node(Value value) : variant(std::move(value)) {}
+    Node(std::string_view value) : variant(String(value)) {}
+    Node(const std::string& value) : variant(String(value)) {}
 
     bool IsInt() const {
         return std::holds_alternative<int>(*this);
@@ -79,15 +155,15 @@ public:
     }
 
     bool IsString() const {
-        return std::holds_alternative<std::string>(*this);
+        return std::holds_alternative<String>(*this);
     }
-    const std::string& AsString() const {
+    const String& AsString() const {
         using namespace std::literals;
         if (!IsString()) {
             throw std::logic_error("Not a string"s);
         }
 
-        return std::get<std::string>(*this);
+        return std::get<String>(*this);
     }
 
     bool IsDict() const {
@@ -102,6 +178,10 @@ public:
         return std::get<Dict>(*this);
     }
 
+    bool IsRawJson() const {
+        return std::holds_alternative<RawJson>(*this);
+    }
+
     bool operator==(const Node& rhs) const {
         return GetValue() == rhs.GetValue();
     }
@@ -120,18 +200,50 @@ inline bool operator!=(const Node& lhs, const Node& rhs) {
     return !(lhs == rhs);
 }
 
+template <typename InputIt>
+void Dict::insert(InputIt first, InputIt last) {
+    const size_t old_size = items_.size();
+    for (; first != last; ++first) {
+        items_.emplace_back(*first);
+    }
+    SortAppended(old_size);
+}
+
 class Document {
 public:
     explicit Document(Node root)
-        : root_(std::move(root)) {
+        : root_(new Node(std::move(root)), RootDeleter{false}) {
     }
 
     const Node& GetRoot() const {
-        return root_;
+        return *root_;
     }
 
 private:
-    Node root_;
+    friend Document Load(std::istream& input);
+    friend Document Load(std::string_view text);
+
+    using Arena = std::pmr::monotonic_buffer_resource;
+
+    // Корень, размещённый в арене, не разрушается: арена освобождается целиком, без обхода дерева
+    struct RootDeleter {
+        bool in_arena;
+
+        void operator()(Node* root) const {
+            if (!in_arena) {
+                delete root;
+            }
+        }
+    };
+
+    Document(std::unique_ptr<Arena> arena, Node* root)
+        : arena_(std::move(arena))
+        , root_(root, RootDeleter{true}) {
+    }
+
+    // арена объявлена первой и освобождается последней
+    std::unique_ptr<Arena> arena_;
+    std::unique_ptr<Node, RootDeleter> root_;
 };
 
 inline bool operator==(const Document& lhs, const Document& rhs) {
@@ -142,8 +254,63 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
+// Читает из потока один документ; символы после него остаются в потоке
 Document Load(std::istream& input);
+// Разбирает текст, целиком состоящий из одного документа
+Document Load(std::string_view text);
+
+enum class PrintStyle {
+    PRETTY,   // с переводами строк и отступами
+    COMPACT,  // без пробельных символов между элементами
+};
+
+// Текст собирается в большом буфере и передаётся потоку крупными кусками
+void Print(const Document& doc, std::ostream& output, PrintStyle style = PrintStyle::PRETTY);
+void Print(const Node& node, std::ostream& output, PrintStyle style = PrintStyle::PRETTY);
+
+// Выводит массив по одному элементу, как только элемент готов: массив целиком нигде не хранится.
+// Текст совпадает с тем, что вывела бы Print для массива из тех же элементов.
+// Если Finish не был вызван (например, из-за исключения), деструктор передаёт потоку все выведенные
+// элементы, и в потоке остаётся незакрытый массив: '[' и элементы без ']'
+class ArrayPrinter {
+public:
+    explicit ArrayPrinter(std::ostream& output, PrintStyle style = PrintStyle::PRETTY);
+    ~ArrayPrinter();
+
+    ArrayPrinter(const ArrayPrinter&) = delete;
+    ArrayPrinter& operator=(const ArrayPrinter&) = delete;
 
-void Print(const Document& doc, std::ostream& output);
+    void Print(const Node& item);
+    // Закрывает массив и передаёт потоку остаток текста
+    void Finish();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+// Экранирует строку по правилам JSON и заключает её в кавычки
+RawJson MakeEscapedString(std::string_view value);
+
+// То же для текста, который функция write выводит в переданный ей поток:
+// текст экранируется по мере вывода и нигде не хранится в исходном виде
+RawJson MakeEscapedString(const std::function<void(std::ostream&)>& write);
+
+// Буфер потока, дописывающий в строку target всё выведенное в него, экранируя по правилам JSON
+class EscapingStringBuf : public std::streambuf {
+public:
+    explicit EscapingStringBuf(std::string& target);
+    ~EscapingStringBuf() override;
+
+protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+private:
+    void Flush();
+
+    std::string& target_;
+    char buffer_[4096];
+};
 
 }  // namespace json
\ No newline at end of file
@@ -1,23 +1,23 @@
 #include "json_builder.h"
 
-#include <string>
-#include <map>
+#include <stdexcept>
+#include <utility>
 
 namespace json
 {
     Builder::Context::Context(Builder &builder) : builder_{builder} {}
 
-    Builder::ArrayItemContext Builder::Context::Value(Node::Value value)
+    Builder::ArrayItemContext Builder::Context::Value(Node value)
     {
-        return {builder_.Value(value)};
+        return {builder_.Value(std::move(value))};
     }
-    Builder::ArrayItemContext Builder::Context::StartArray()
+    Builder::ArrayItemContext Builder::Context::StartArray(size_t size_hint)
     {
-        return {builder_.StartArray()};
+        return {builder_.StartArray(size_hint)};
     }
-    Builder::DictItemContext Builder::Context::StartDict()
+    Builder::DictItemContext Builder::Context::StartDict(size_t size_hint)
     {
-        return {builder_.StartDict()};
+        return {builder_.StartDict(size_hint)};
     }
     Builder &Builder::Context::EndArray()
     {
@@ -25,9 +25,9 @@ namespace json
         return builder_;
     }
 
-    Builder::DictKeyContext Builder::Context::Key(std::string key)
+    Builder::DictKeyContext Builder::Context::Key(std::string_view key)
     {
-        return builder_.Key(std::move(key));
+        return builder_.Key(key);
     }
     Builder &Builder::Context::EndDict()
     {
@@ -35,39 +35,36 @@ namespace json
         return builder_;
     }
 
-    Builder::DictItemContext Builder::Context::ValueInDictItem(Node::Value value)
+    Builder::DictItemContext Builder::Context::ValueInDictItem(Node value)
     {
-        return {builder_.Value(value)};
+        return {builder_.Value(std::move(value))};
     }
 
     Builder::ArrayItemContext::ArrayItemContext(Builder &builder) : Context{builder} {}
     Builder::DictItemContext::DictItemContext(Builder &builder) : Context{builder} {}
     Builder::DictKeyContext::DictKeyContext(Builder &builder) : Context{builder} {}
 
-    Builder::Builder()
-    {
-        nodes_stack_.push_back(&root_);
-    }
+    Builder::Builder(std::pmr::memory_resource* resource) : resource_{resource}, nodes_stack_{resource}, key_{resource} {}
 
     Node Builder::Build()
     {
-        if (!(nodes_stack_.back() == &root_) || (root_.IsNull()))
+        if (!nodes_stack_.empty() || (root_.IsNull()))
         {
             throw std::logic_error("Can't build: context not complete or file is empty");
         }
-        return root_;
+        return std::move(root_);
     }
 
-    Builder::DictItemContext Builder::StartDict()
+    Builder::DictItemContext Builder::StartDict(size_t size_hint)
     {
         if (IsReadyCheck())
         {
             throw std::logic_error("Trying to call StartDict method for complete object");
         }
         CheckCorrectValuePlacing("StartDict command not after key or not inside in array or not after the constructor");
-        Dict new_map;
-        Node *dict_ptr = new Node(new_map);
-        nodes_stack_.push_back(dict_ptr);
+        Dict new_map(resource_);
+        new_map.reserve(size_hint);
+        nodes_stack_.push_back(&PlaceValue(std::move(new_map)));
 
         return {*this};
     }
@@ -78,27 +75,25 @@ namespace json
         {
             throw std::logic_error("Trying to call EndDict method for complete object");
         }
-        if (!nodes_stack_.back()->IsDict())
+        if (nodes_stack_.empty() || !nodes_stack_.back()->IsDict() || has_key_)
         {
             throw std::logic_error("EndDict command in a wrong place");
         }
-        Node *complete_dict_node = nodes_stack_.back();
         nodes_stack_.pop_back();
-        Value(complete_dict_node->AsDict());
 
         return *this;
     }
 
-    Builder::ArrayItemContext Builder::StartArray()
+    Builder::ArrayItemContext Builder::StartArray(size_t size_hint)
     {
         if (IsReadyCheck())
         {
             throw std::logic_error("Trying to call StartArray method for complete object");
         }
         CheckCorrectValuePlacing("StartArray command not after key or not inside in array or not after the constructor");
-        Array new_array;
-        Node *arr_ptr = new Node(new_array);
-        nodes_stack_.push_back(arr_ptr);
+        Array new_array(resource_);
+        new_array.reserve(size_hint);
+        nodes_stack_.push_back(&PlaceValue(std::move(new_array)));
 
         return {*this};
     }
@@ -109,92 +104,72 @@ namespace json
         {
             throw std::logic_error("Trying to call EndArray method for complete object");
         }
-        if (!nodes_stack_.back()->IsArray())
+        if (nodes_stack_.empty() || !nodes_stack_.back()->IsArray())
         {
             throw std::logic_error("EndArray command in a wrong place");
         }
-        Node *complete_arr_node = nodes_stack_.back();
         nodes_stack_.pop_back();
-        Value(complete_arr_node->AsArray());
 
         return *this;
     }
 
-    Builder::DictKeyContext Builder::Key(std::string key)
+    Builder::DictKeyContext Builder::Key(std::string_view key)
     {
         if (IsReadyCheck())
         {
             throw std::logic_error("Trying to call Key method for complete object");
         }
-        if (!nodes_stack_.back()->IsDict())
+        if (nodes_stack_.empty() || !nodes_stack_.back()->IsDict() || has_key_)
         {
             throw std::logic_error("Key command not inside dict or after another key command");
         }
-        Node *key_ptr = new Node(key);
-        nodes_stack_.push_back(key_ptr);
+        key_.assign(key);
+        has_key_ = true;
 
         return {*this};
     }
 
-    Builder &Builder::Value(Node::Value value)
+    Builder &Builder::Value(Node value)
     {
         if (IsReadyCheck())
         {
             throw std::logic_error("Trying to call Value method for complete object");
         }
         CheckCorrectValuePlacing("Value command not after key or not inside in array or not after the constructor");
-        Node *stack_frame = nodes_stack_.back();
-        if (stack_frame->IsString())
-        {
-            std::string key = stack_frame->AsString();
-            nodes_stack_.pop_back();
-            Dict &dict = std::get<Dict>(nodes_stack_.back()->GetValue());
-            dict[key] = Node(value);
-        }
-        else if (stack_frame->IsArray())
-        {
-            Array &array = std::get<Array>(stack_frame->GetValue());
-            array.push_back(Node(value));
-        }
-        else if (stack_frame == &root_)
-        {
-            root_ = Node(value);
-        }
+        PlaceValue(std::move(value));
 
         return *this;
     }
 
-    void Builder::CheckCorrectValuePlacing(const std::string &err_msg)
+    Node &Builder::PlaceValue(Node value)
     {
-        Node *stack_frame = nodes_stack_.back();
-        if (!(stack_frame->IsString()) && !(stack_frame->IsArray()) && !(stack_frame == &root_))
+        if (nodes_stack_.empty())
         {
-            throw std::logic_error(err_msg);
+            root_ = std::move(value);
+            return root_;
         }
-        return;
+        Node &parent = *nodes_stack_.back();
+        if (has_key_)
+        {
+            has_key_ = false;
+            // повторный ключ, как и прежде, заменяет значение
+            Node &slot = std::get<Dict>(parent.GetValue())[key_];
+            slot = std::move(value);
+            return slot;
+        }
+        return std::get<Array>(parent.GetValue()).emplace_back(std::move(value));
     }
 
-    bool Builder::IsReadyCheck()
+    void Builder::CheckCorrectValuePlacing(const char *err_msg) const
     {
-        if (nodes_stack_.back() == &root_ && !root_.IsNull())
+        if (!has_key_ && !nodes_stack_.empty() && !nodes_stack_.back()->IsArray())
         {
-            return true;
+            throw std::logic_error(err_msg);
         }
-        return false;
     }
-    /*
-    void Builder::AddValueToParentNode(const Node* node_to_add, Node* parent_node)
-    {
-        if (parent_node == &root_)
-        {
-            root_ = Node(node_to_add->GetValue());
-        } else if (parent_node->IsArray())
-        {
 
-        } else if (parent_node->IsString())
-        {
-            Dict& dict = std::get<Dict>(parent_node->GetValue());
-            dict
-        }
-    }*/
-}
\ No newline at end of file
+    bool Builder::IsReadyCheck() const
+    {
+        return nodes_stack_.empty() && !root_.IsNull();
+    }
+}
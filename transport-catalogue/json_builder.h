@@ -1,9 +1,15 @@
 #pragma once
 #include "json.h"
 
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
 namespace json
 {
 
+    // Строит узел прямо на его месте в дереве: значения перемещаются в родительский
+    // массив или словарь, а открытые массивы и словари не копируются при закрытии
     class Builder
     {
     private:
@@ -18,12 +24,12 @@ namespace json
 
             Builder &builder_;
 
-            ArrayItemContext Value(Node::Value value);
-            DictItemContext ValueInDictItem(Node::Value value);
-            ArrayItemContext StartArray();
+            ArrayItemContext Value(Node value);
+            DictItemContext ValueInDictItem(Node value);
+            ArrayItemContext StartArray(size_t size_hint = 0);
             Builder &EndArray();
-            DictItemContext StartDict();
-            DictKeyContext Key(std::string key);
+            DictItemContext StartDict(size_t size_hint = 0);
+            DictKeyContext Key(std::string_view key);
             Builder &EndDict();
         };
 
@@ -33,8 +39,8 @@ namespace json
         public:
             ArrayItemContext(Builder &builder);
 
-            DictItemContext Value(Node::Value value) = delete;
-            DictKeyContext Key(std::string key) = delete;
+            DictItemContext Value(Node value) = delete;
+            DictKeyContext Key(std::string_view key) = delete;
             Builder &EndDict() = delete;
         };
 
@@ -43,11 +49,11 @@ namespace json
         public:
             DictItemContext(Builder &builder);
 
-            ArrayItemContext Value(Node::Value value) = delete;
-            DictItemContext ValueInDictItem(Node::Value value) = delete;
-            ArrayItemContext StartArray() = delete;
+            ArrayItemContext Value(Node value) = delete;
+            DictItemContext ValueInDictItem(Node value) = delete;
+            ArrayItemContext StartArray(size_t size_hint = 0) = delete;
             Builder &EndArray() = delete;
-            DictItemContext StartDict() = delete;
+            DictItemContext StartDict(size_t size_hint = 0) = delete;
         };
 
         class DictKeyContext : public Context
@@ -55,34 +61,46 @@ namespace json
         public:
             DictKeyContext(Builder &builder);
 
-            ArrayItemContext Value(Node::Value value) = delete;
+            ArrayItemContext Value(Node value) = delete;
             Builder &EndArray()  = delete;
-            DictKeyContext Key(std::string key) = delete;
+            DictKeyContext Key(std::string_view key) = delete;
             Builder &EndDict() = delete;
         };
 
     public:
-        Builder();
+        // Массивы и словари, ключи и служебный стек строителя берут память у resource.
+        // Узел, построенный в арене, живёт не дольше её; его копии берут память из кучи
+        explicit Builder(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
+        // Отдаёт построенный узел; после этого строитель больше не используется
         Node Build();
 
-        DictKeyContext Key(std::string);
-        Builder &Value(Node::Value);
+        // Ключ копируется прямо в словарь: для коротких ключей-констант память не выделяется
+        DictKeyContext Key(std::string_view key);
+        Builder &Value(Node value);
 
-        DictItemContext StartDict();
+        // size_hint — ожидаемое число элементов: место под них выделяется сразу
+        DictItemContext StartDict(size_t size_hint = 0);
         Builder &EndDict();
 
-        ArrayItemContext StartArray();
+        ArrayItemContext StartArray(size_t size_hint = 0);
         Builder &EndArray();
 
     private:
+        std::pmr::memory_resource* resource_;
         Node root_;
-        std::vector<Node *> nodes_stack_;
-
-        bool IsReadyCheck();
-        void CheckCorrectValuePlacing(const std::string &err_msg);
-
-        void AddValueToParentNode(const Node *node_to_add, Node *parent_node);
+        // Открытые массивы и словари. Каждый из них лежит внутри предыдущего, который
+        // не меняется, пока вложенный открыт, поэтому указатели на них остаются верными
+        std::pmr::vector<Node *> nodes_stack_;
+        // Ключ, ожидающий значения в словаре на вершине стека
+        String key_;
+        bool has_key_ = false;
+
+        bool IsReadyCheck() const;
+        void CheckCorrectValuePlacing(const char *err_msg) const;
+
+        // Помещает значение на очередное место и возвращает ссылку на него в дереве
+        Node &PlaceValue(Node value);
     };
 
-}
\ No newline at end of file
+}
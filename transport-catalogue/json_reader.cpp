@@ -1,6 +1,9 @@
     #include "json_reader.h"
     #include <algorithm>
+    #include <cctype>
     #include <iomanip>
+    #include <type_traits>
+    #include <unordered_map>
     #include "map_renderer.h"
     #include "json_builder.h"
     /*
@@ -14,186 +17,537 @@
         namespace Input
         {
 
-            BaseRequest::BaseRequest(BaseRequestType new_type, const std::string &new_name) : type{new_type}, name{new_name} {}
-
-            AddStopRequest::AddStopRequest(BaseRequestType new_type, const std::string &new_name,
-                                           detail::Coordinates new_coords, const std::vector<std::pair<std::string, double>> &distances) : BaseRequest{new_type, new_name}, coords{new_coords}, distances_to_other_stops{std::move(distances)} {}
-
-            AddBusRequest::AddBusRequest(BaseRequestType new_type, const std::string &new_name, const std::vector<std::string> &new_stops, bool isroundtrip)
-                : BaseRequest{new_type, new_name}, stops{std::move(new_stops)}, is_roundtrip{isroundtrip} {}
-
             StatRequest::StatRequest(size_t new_id, StatRequestType new_type) : id{new_id}, type{new_type} {}
-            BusInfoRequest::BusInfoRequest(size_t new_id, StatRequestType new_type, std::string new_name) : StatRequest{new_id, new_type}, name{new_name} {}
-            StopInfoRequest::StopInfoRequest(size_t new_id, StatRequestType new_type, std::string new_name) : StatRequest{new_id, new_type}, name{new_name} {}
+            BusInfoRequest::BusInfoRequest(size_t new_id, StatRequestType new_type, std::string new_name) : StatRequest{new_id, new_type}, name{std::move(new_name)} {}
+            StopInfoRequest::StopInfoRequest(size_t new_id, StatRequestType new_type, std::string new_name) : StatRequest{new_id, new_type}, name{std::move(new_name)} {}
             MapRenderRequest::MapRenderRequest(size_t new_id, StatRequestType new_type) : StatRequest{new_id, new_type} {}
             RouteRequest::RouteRequest(size_t new_id, StatRequestType new_type, std::string name_from, std::string name_to) :
             StatRequest{new_id, new_type}, from{move(name_from)}, to{move(name_to)} {}
+            RouteMapRequest::RouteMapRequest(size_t new_id, StatRequestType new_type, std::string name_from, std::string name_to) :
+            StatRequest{new_id, new_type}, from{move(name_from)}, to{move(name_to)} {}
+            NearestStopsRequest::NearestStopsRequest(size_t new_id, StatRequestType new_type, detail::Coordinates new_center,
+                                                     std::optional<double> new_radius, std::optional<size_t> new_count) :
+            StatRequest{new_id, new_type}, center{new_center}, radius{new_radius}, count{new_count} {}
+            MapTileRequest::MapTileRequest(size_t new_id, StatRequestType new_type, Render::MapViewport new_viewport) :
+            StatRequest{new_id, new_type}, viewport{new_viewport} {}
+            ReloadRequest::ReloadRequest(size_t new_id, StatRequestType new_type) : StatRequest{new_id, new_type} {}
+            InvalidRequest::InvalidRequest(std::optional<size_t> new_id, std::string new_error_message) :
+            StatRequest{new_id.value_or(0), StatRequestType::INVALID}, has_id{new_id.has_value()}, error_message{std::move(new_error_message)} {}
+
+            std::unique_ptr<NearestStopsRequest> MakeNearestStopsRequest(size_t id, detail::Coordinates center,
+                                                                         std::optional<double> radius, std::optional<int> count)
+            {
+                if (count.has_value() && *count < 0)
+                {
+                    throw std::invalid_argument("Negative count in NearestStops request");
+                }
+                if (!radius.has_value() && !count.has_value())
+                {
+                    throw std::invalid_argument("NearestStops request needs \"radius\" or \"count\"");
+                }
+                std::optional<size_t> max_count;
+                if (count.has_value())
+                {
+                    max_count = static_cast<size_t>(*count);
+                }
+                return std::make_unique<NearestStopsRequest>(id, StatRequestType::NEAREST_STOPS, center, radius, max_count);
+            }
+
+            std::unique_ptr<MapTileRequest> MakeMapTileRequest(size_t id, Render::MapViewport viewport)
+            {
+                if (!(viewport.min.lat < viewport.max.lat) || !(viewport.min.lng < viewport.max.lng))
+                {
+                    throw std::invalid_argument("Empty area in MapTile request");
+                }
+                if (viewport.width.value_or(1.) <= 0. || viewport.height.value_or(1.) <= 0.)
+                {
+                    throw std::invalid_argument("Image size in MapTile request must be positive");
+                }
+                return std::make_unique<MapTileRequest>(id, StatRequestType::MAP_TILE, viewport);
+            }
+
+            namespace
+            {
+                json::Node MakeErrorResponse(std::optional<size_t> id, std::string_view error_message)
+                {
+                    using namespace std::literals;
+
+                    json::Builder builder;
+                    builder.StartDict(2);
+                    if (id.has_value())
+                    {
+                        builder.Key("request_id"sv).ValueInDictItem(static_cast<int>(*id));
+                    }
+                    return builder.Key("error_message"sv).ValueInDictItem(error_message).EndDict().Build();
+                }
+
+                // id запроса, если он есть и записан целым числом
+                // Начальный буфер арены ответов: в него помещается ответ с маршрутом из сотни элементов
+                const size_t RESPONSE_ARENA_SIZE = 64 * 1024;
+
+                std::optional<size_t> FindRequestId(const json::Node& request)
+                {
+                    if (!request.IsDict() || !request.AsDict().count("id") || !request.AsDict().at("id").IsInt())
+                    {
+                        return std::nullopt;
+                    }
+                    return static_cast<size_t>(request.AsDict().at("id").AsInt());
+                }
+
+                // Дописывает в key ключ запроса из его типа и параметров. Строки записываются вместе с длиной,
+                // а числа — своим двоичным представлением, поэтому разные запросы не дают одинаковых ключей
+                class CacheKeyBuilder
+                {
+                public:
+                    CacheKeyBuilder(std::string& key, StatRequestType type) : key_{key}
+                    {
+                        key_.push_back(static_cast<char>(type));
+                    }
 
+                    CacheKeyBuilder& Add(std::string_view text)
+                    {
+                        Add(text.size());
+                        key_.append(text);
+                        return *this;
+                    }
 
-            json::Node BusInfoRequest::Process(JSONReader &jreader, [[maybe_unused]] ReqHandler::RequestHandler &rh)
+                    template <typename Number, std::enable_if_t<std::is_arithmetic_v<Number>, int> = 0>
+                    CacheKeyBuilder& Add(Number value)
+                    {
+                        key_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+                        return *this;
+                    }
+
+                    template <typename Number>
+                    CacheKeyBuilder& Add(const std::optional<Number>& value)
+                    {
+                        Add(value.has_value());
+                        return value.has_value() ? Add(*value) : *this;
+                    }
+
+                private:
+                    std::string& key_;
+                };
+            }
+
+            bool StatRequest::AppendCacheKey([[maybe_unused]] std::string& key) const
+            {
+                return false;
+            }
+
+            bool BusInfoRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type}.Add(name);
+                return true;
+            }
+
+            bool StopInfoRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type}.Add(name);
+                return true;
+            }
+
+            bool MapRenderRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type};
+                return true;
+            }
+
+            bool RouteRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type}.Add(from).Add(to);
+                return true;
+            }
+
+            bool RouteMapRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type}.Add(from).Add(to);
+                return true;
+            }
+
+            bool NearestStopsRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type}.Add(center.lat).Add(center.lng).Add(radius).Add(count);
+                return true;
+            }
+
+            bool MapTileRequest::AppendCacheKey(std::string& key) const
+            {
+                CacheKeyBuilder{key, type}.Add(viewport.min.lat).Add(viewport.min.lng).Add(viewport.max.lat).Add(viewport.max.lng)
+                                                 .Add(viewport.width).Add(viewport.height);
+                return true;
+            }
+
+            std::vector<size_t> FindRepeatedRequests(const std::vector<std::unique_ptr<StatRequest>>& requests)
+            {
+                // Ключи всех запросов пишутся подряд в один буфер, а ищутся в открытой хеш-таблице
+                // номеров запросов: пакет без повторов обходится несколькими выделениями памяти на весь пакет
+                std::vector<size_t> first(requests.size());
+                std::vector<size_t> key_ends(requests.size());
+                std::string keys;
+                keys.reserve(requests.size() * 32);
+                for (size_t i = 0; i < requests.size(); ++i)
+                {
+                    first[i] = requests[i]->AppendCacheKey(keys) ? requests.size() : i;
+                    key_ends[i] = keys.size();
+                }
+                auto get_key = [&](size_t i)
+                {
+                    const size_t begin = i == 0 ? 0 : key_ends[i - 1];
+                    return std::string_view{keys}.substr(begin, key_ends[i] - begin);
+                };
+
+                // Таблица заполнена не больше чем наполовину; NO_REQUEST — пустая ячейка
+                const size_t NO_REQUEST = requests.size();
+                size_t table_size = 1;
+                while (table_size < requests.size() * 2)
+                {
+                    table_size *= 2;
+                }
+                std::vector<size_t> table(table_size, NO_REQUEST);
+                const std::hash<std::string_view> hasher;
+                for (size_t i = 0; i < requests.size(); ++i)
+                {
+                    if (first[i] != NO_REQUEST)
+                    {
+                        continue;
+                    }
+                    const std::string_view key = get_key(i);
+                    size_t cell = hasher(key) & (table_size - 1);
+                    while (table[cell] != NO_REQUEST && get_key(table[cell]) != key)
+                    {
+                        cell = (cell + 1) & (table_size - 1);
+                    }
+                    if (table[cell] == NO_REQUEST)
+                    {
+                        table[cell] = i;
+                    }
+                    first[i] = table[cell];
+                }
+                return first;
+            }
+
+            std::ostream& operator<<(std::ostream& out, const StatBatchStats& stats)
+            {
+                return out << "Stat requests: " << stats.requests << ", computed: " << stats.computed
+                           << ", answered from cache: " << stats.requests - stats.computed;
+            }
+
+
+            json::Node BusInfoRequest::Process(JSONReader &jreader, ReqHandler::RequestHandler &rh)
             {
                 using namespace std::literals;
-                auto info = jreader.tc_.GetBusInfo(name);
+                auto info = rh.GetBusStat(name);
 
                 if (!info.has_value())
                 {
-                    return json::Builder{}
-                    .StartDict()
-                        .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                        .Key("error_message").ValueInDictItem("not found"s)
+                    return json::Builder{jreader.GetResponseResource()}
+                    .StartDict(2)
+                        .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                        .Key("error_message"sv).ValueInDictItem("not found"sv)
                     .EndDict()
                     .Build();
                 }
 
-                return json::Builder{}.StartDict()
-                    .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                    .Key("route_length").ValueInDictItem(info->route_length)
-                    .Key("curvature").ValueInDictItem(info->curvature)
-                    .Key("stop_count").ValueInDictItem(static_cast<int>(info->stops))
-                    .Key("unique_stop_count").ValueInDictItem(static_cast<int>(info->unique_stops))
+                return json::Builder{jreader.GetResponseResource()}.StartDict(5)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("route_length"sv).ValueInDictItem(info->route_length)
+                    .Key("curvature"sv).ValueInDictItem(info->curvature)
+                    .Key("stop_count"sv).ValueInDictItem(static_cast<int>(info->stops))
+                    .Key("unique_stop_count"sv).ValueInDictItem(static_cast<int>(info->unique_stops))
                 .EndDict()
                 .Build();
             }
 
-            json::Node StopInfoRequest::Process(JSONReader &jreader, [[maybe_unused]] ReqHandler::RequestHandler &rh)
+            json::Node StopInfoRequest::Process(JSONReader &jreader, ReqHandler::RequestHandler &rh)
             {
                 using namespace std::literals;
-                auto info = jreader.tc_.GetStopInfo(name);
+                auto info = rh.GetStopStat(name);
                 if (!info.has_value())
                 {
-                    return json::Builder{}
-                    .StartDict()
-                        .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                        .Key("error_message").ValueInDictItem("not found"s)
+                    return json::Builder{jreader.GetResponseResource()}
+                    .StartDict(2)
+                        .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                        .Key("error_message"sv).ValueInDictItem("not found"sv)
                     .EndDict()
                     .Build();
                 }
 
-                json::Array arr;
+                // массив автобусов собирается прямо в словаре ответа
+                json::Builder builder{jreader.GetResponseResource()};
+                builder.StartDict(2)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("buses"sv).StartArray(info->buses.size());
                 for (std::string_view bus_stop : info->buses)
                 {
-                    arr.push_back({static_cast<std::string>(bus_stop)});
+                    builder.Value(bus_stop);
                 }
+                return builder.EndArray().EndDict().Build();
+            }
 
-                return json::Builder{}
-                .StartDict()
-                    .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                    .Key("buses").ValueInDictItem(arr)
+            json::Node MapRenderRequest::Process(JSONReader &jreader, ReqHandler::RequestHandler &rh)
+            {
+                using namespace std::literals;
+                // карту, не отрисованную заранее, выводим сразу в экранированную строку ответа
+                json::RawJson map = rh.HasRenderedMap()
+                    ? jreader.GetEscapedMap(rh.GetRenderedMap())
+                    : json::MakeEscapedString([&rh](std::ostream& out) { rh.RenderMapSvg(out); });
+
+                return json::Builder{jreader.GetResponseResource()}
+                .StartDict(2)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("map"sv).ValueInDictItem(std::move(map))
                 .EndDict()
                 .Build();
             }
 
-            json::Node MapRenderRequest::Process([[maybe_unused]] JSONReader &jreader, ReqHandler::RequestHandler &rh)
+            json::Node MapTileRequest::Process(JSONReader &jreader, ReqHandler::RequestHandler &rh)
             {
-                std::stringstream ss;
-                rh.RenderMap().Render(ss);
-
-                return json::Builder{}
-                .StartDict()
-                    .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                    .Key("map").ValueInDictItem(ss.str())
+                using namespace std::literals;
+                return json::Builder{jreader.GetResponseResource()}
+                .StartDict(2)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("map"sv).ValueInDictItem(json::MakeEscapedString([this, &rh](std::ostream& out) { rh.RenderMapTile(viewport, out); }))
                 .EndDict()
                 .Build();
             }
 
-            json::Node RouteRequest::Process([[maybe_unused]] JSONReader& jreader, ReqHandler::RequestHandler& rh)
+            json::Node RouteRequest::Process(JSONReader& jreader, ReqHandler::RequestHandler& rh)
             {
                 using namespace std::literals;
 
                 std::optional<Router::Route> built_route = rh.BuildRoute(from, to);
                 if (!built_route.has_value() || built_route.value().total_time == -1)
                 {
-                    return json::Builder{}
-                    .StartDict()
-                        .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                        .Key("error_message").ValueInDictItem("not found"s)
+                    return json::Builder{jreader.GetResponseResource()}
+                    .StartDict(2)
+                        .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                        .Key("error_message"sv).ValueInDictItem("not found"sv)
                     .EndDict()
                     .Build();
                 }
 
-                json::Array items_arr;
+                // элементы маршрута добавляются прямо в массив items, без промежуточных узлов
+                json::Builder builder{jreader.GetResponseResource()};
+                builder.StartDict(3)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("total_time"sv).ValueInDictItem(built_route.value().total_time)
+                    .Key("items"sv).StartArray(built_route.value().route_details.size());
                 for (const auto& route_element : built_route.value().route_details)
                 {
-                    if (std::holds_alternative<Router::Route::RouteElementWait>(route_element))
+                    if (const auto* wait = std::get_if<Router::Route::RouteElementWait>(&route_element))
                     {
-                        json::Node wait_node = json::Builder{}
-                        .StartDict()
-                            .Key("type").ValueInDictItem("Wait"s)
-                            .Key("stop_name").ValueInDictItem(std::get<Router::Route::RouteElementWait>(route_element).stop_name)
-                            .Key("time").ValueInDictItem(std::get<Router::Route::RouteElementWait>(route_element).time)
-                        .EndDict()
-                        .Build();
-                        items_arr.push_back(wait_node);
+                        builder.StartDict(3)
+                            .Key("type"sv).ValueInDictItem("Wait"sv)
+                            .Key("stop_name"sv).ValueInDictItem(wait->stop_name)
+                            .Key("time"sv).ValueInDictItem(wait->time)
+                        .EndDict();
                         continue;
                     }
-                    json::Node bus_node = json::Builder{}
-                        .StartDict()
-                            .Key("type").ValueInDictItem("Bus"s)
-                            .Key("bus").ValueInDictItem(std::get<Router::Route::RouteElementBus>(route_element).bus)
-                            .Key("span_count").ValueInDictItem(std::get<Router::Route::RouteElementBus>(route_element).span_count)
-                            .Key("time").ValueInDictItem(std::get<Router::Route::RouteElementBus>(route_element).time)
-                        .EndDict()
-                        .Build();
-                    items_arr.push_back(bus_node);
-                }
-
-                return json::Builder{}
-                    .StartDict()
-                        .Key("request_id").ValueInDictItem(static_cast<int>(id))
-                        .Key("total_time").ValueInDictItem(built_route.value().total_time)
-                        .Key("items").ValueInDictItem(items_arr)
+                    const auto& bus = std::get<Router::Route::RouteElementBus>(route_element);
+                    builder.StartDict(4)
+                        .Key("type"sv).ValueInDictItem("Bus"sv)
+                        .Key("bus"sv).ValueInDictItem(bus.bus)
+                        .Key("span_count"sv).ValueInDictItem(bus.span_count)
+                        .Key("time"sv).ValueInDictItem(bus.time)
+                    .EndDict();
+                }
+                return builder.EndArray().EndDict().Build();
+            }
+
+            json::Node RouteMapRequest::Process(JSONReader& jreader, ReqHandler::RequestHandler& rh)
+            {
+                using namespace std::literals;
+
+                std::optional<Router::Route> built_route = rh.BuildRoute(from, to);
+                if (!built_route.has_value() || built_route.value().total_time == -1)
+                {
+                    return json::Builder{jreader.GetResponseResource()}
+                    .StartDict(2)
+                        .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                        .Key("error_message"sv).ValueInDictItem("not found"sv)
                     .EndDict()
                     .Build();
-            }
+                }
 
-            JSONReader::JSONReader(Core::TransportCatalogue &tc, std::istream &in) : tc_{tc}, in_{in} {}
+                return json::Builder{jreader.GetResponseResource()}
+                .StartDict(2)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("map"sv).ValueInDictItem(json::MakeEscapedString([this, &rh, &built_route](std::ostream& out)
+                    {
+                        rh.RenderRouteMap(built_route.value(), to, out);
+                    }))
+                .EndDict()
+                .Build();
+            }
 
-            void JSONReader::Print(std::ostream &out, json::Document doc_to_print)
+            json::Node NearestStopsRequest::Process(JSONReader& jreader, ReqHandler::RequestHandler& rh)
             {
-                json::Print(doc_to_print, out);
+                using namespace std::literals;
+
+                const std::vector<Core::NearbyStop> stops = rh.GetNearestStops(center, radius, count);
+
+                json::Builder builder{jreader.GetResponseResource()};
+                builder.StartDict(2)
+                    .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                    .Key("stops"sv).StartArray(stops.size());
+                for (const Core::NearbyStop& stop : stops)
+                {
+                    builder.StartDict(2)
+                        .Key("name"sv).ValueInDictItem(stop.name)
+                        .Key("distance"sv).ValueInDictItem(stop.distance)
+                    .EndDict();
+                }
+                return builder.EndArray().EndDict().Build();
             }
 
-            void JSONReader::SendBaseRequests()
+            json::Node ReloadRequest::Process(JSONReader& jreader, ReqHandler::RequestHandler& rh)
             {
-                for (const AddStopRequest &stop_command : commands_.base_requests.add_stop)
+                using namespace std::literals;
+
+                std::optional<ReqHandler::BaseGenerationInfo> info = rh.Reload();
+                if (!info.has_value())
                 {
-                    tc_.AddStop(stop_command.name, stop_command.coords);
+                    return json::Builder{jreader.GetResponseResource()}
+                    .StartDict(2)
+                        .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                        .Key("error_message"sv).ValueInDictItem("reload is not supported"sv)
+                    .EndDict()
+                    .Build();
                 }
 
-                for (const AddStopRequest &stop_command : commands_.base_requests.add_stop)
+                return json::Builder{jreader.GetResponseResource()}
+                    .StartDict(4)
+                        .Key("request_id"sv).ValueInDictItem(static_cast<int>(id))
+                        .Key("generation"sv).ValueInDictItem(static_cast<int>(info->generation))
+                        .Key("load_time"sv).ValueInDictItem(info->load_time_ms)
+                        .Key("reload_started"sv).ValueInDictItem(info->reload_started)
+                    .EndDict()
+                    .Build();
+            }
+
+            json::Node InvalidRequest::Process([[maybe_unused]] JSONReader& jreader, [[maybe_unused]] ReqHandler::RequestHandler& rh)
+            {
+                return MakeErrorResponse(has_id ? std::optional<size_t>{id} : std::nullopt, error_message);
+            }
+
+            JSONReader::JSONReader(Core::TransportCatalogue &tc, std::istream &in, json::PrintStyle output_style)
+                : tc_{&tc}, in_{in}, output_style_{output_style},
+                  response_buffer_(RESPONSE_ARENA_SIZE), response_arena_{response_buffer_.data(), response_buffer_.size()} {}
+
+            JSONReader::JSONReader(std::istream &in, json::PrintStyle output_style)
+                : in_{in}, output_style_{output_style},
+                  response_buffer_(RESPONSE_ARENA_SIZE), response_arena_{response_buffer_.data(), response_buffer_.size()} {}
+
+            std::pmr::memory_resource* JSONReader::GetResponseResource()
+            {
+                return &response_arena_;
+            }
+
+            json::RawJson JSONReader::GetEscapedMap(const std::shared_ptr<const std::string>& map_svg)
+            {
+                if (cached_map_source_ != map_svg)
                 {
-                    SetDistancesToOtherStops(stop_command.name, stop_command.distances_to_other_stops);
+                    cached_map_json_ = json::MakeEscapedString(*map_svg);
+                    cached_map_source_ = map_svg;
                 }
+                return cached_map_json_;
+            }
 
-                for (const AddBusRequest &bus_command : commands_.base_requests.add_bus)
+            void JSONReader::Print(std::ostream &out, json::Document doc_to_print)
+            {
+                json::Print(doc_to_print, out, output_style_);
+            }
+
+            void JSONReader::SendStatRequests(ReqHandler::RequestHandler &rh)
+            {
+                const std::vector<size_t> first = FindRepeatedRequests(stat_requests_);
+                // Ответ хранится, только пока его ждут повторы запроса
+                std::vector<size_t> repeats_left(stat_requests_.size());
+                for (size_t i = 0; i < first.size(); ++i)
                 {
-                    tc_.AddBus(bus_command.name, bus_command.stops, bus_command.is_roundtrip);
+                    if (first[i] != i)
+                    {
+                        ++repeats_left[first[i]];
+                    }
                 }
+                std::unordered_map<size_t, json::Node> cached_responses;
+                last_batch_stats_ = {stat_requests_.size(), 0};
+
+                // ответы выводятся по мере готовности, и массив всех ответов в памяти не собирается.
+                // Если запрос выбросит исключение, ArrayPrinter при разрушении передаст потоку ответы
+                // на предыдущие запросы, и вывод закончится незакрытым массивом
+                json::ArrayPrinter printer(std::cout, output_style_);
+                for (size_t i = 0; i < stat_requests_.size(); ++i)
+                {
+                    // ответ на предыдущий запрос уже выведен и разрушен
+                    response_arena_.release();
+                    if (first[i] == i)
+                    {
+                        ++last_batch_stats_.computed;
+                        const json::Node response = stat_requests_[i]->Process(*this, rh);
+                        printer.Print(response);
+                        if (repeats_left[i] > 0)
+                        {
+                            // повторы ждут ответ дольше, чем живёт арена: для них хранится копия в куче
+                            cached_responses.emplace(i, response);
+                        }
+                        continue;
+                    }
+
+                    const auto cached = cached_responses.find(first[i]);
+                    json::Node& response = cached->second;
+                    std::get<json::Dict>(response.GetValue()).at("request_id") = static_cast<int>(stat_requests_[i]->id);
+                    printer.Print(response);
+                    if (--repeats_left[first[i]] == 0)
+                    {
+                        cached_responses.erase(cached);
+                    }
+                }
+                printer.Finish();
+                stat_requests_.clear();
             }
 
-            void JSONReader::SendStatRequests(ReqHandler::RequestHandler &rh)
+            StatBatchStats JSONReader::GetLastBatchStats() const
             {
-                json::Builder builder{};
-                builder.StartArray();
+                return last_batch_stats_;
+            }
 
+            void JSONReader::SendStatRequestLines(ReqHandler::RequestHandler &rh)
+            {
                 for (const auto &req : stat_requests_)
                 {
-                    builder.Value(req->Process(*this, rh).AsDict());
+                    response_arena_.release();
+                    json::Node response;
+                    try
+                    {
+                        response = req->Process(*this, rh);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        response = MakeErrorResponse(req->id, e.what());
+                    }
+                    // ответ должен уместиться в одну строку, поэтому выводится без отступов
+                    json::Print(response, std::cout, json::PrintStyle::COMPACT);
+                    std::cout.put('\n');
                 }
-
-                builder.EndArray();
-
-                Print(std::cout, json::Document{builder.Build()});
+                stat_requests_.clear();
             }
 
             void JSONReader::ReadMakeBaseJSON()
             {
-                json::Node root_node = json::Load(in_).GetRoot();
+                if (tc_ == nullptr)
+                {
+                    throw std::logic_error("JSONReader without catalogue can't read base requests");
+                }
+                // узлы документа живут в его арене, пока документ не выйдет из области видимости
+                const json::Document document = json::Load(in_);
+                const json::Node& root_node = document.GetRoot();
                 if (!root_node.IsDict())
                 {
                     throw std::invalid_argument("Parent node of JSON is not map");
                 }
-                json::Dict map = root_node.AsDict();
+                const json::Dict& map = root_node.AsDict();
 
                 if (!map.count("base_requests"))
                 {
@@ -203,9 +557,8 @@
                 {
                     throw std::invalid_argument("Key \"base_requests\" is not array in JSON");
                 }
-                json::Array base_requests = map.at("base_requests").AsArray();
+                const json::Array& base_requests = map.at("base_requests").AsArray();
                 ProcessBaseRequests(base_requests);
-                SendBaseRequests();
 
 
                 if (!map.count("render_settings"))
@@ -216,7 +569,7 @@
                 {
                     throw std::invalid_argument("Key \"render_settings\" is not map in JSON");
                 }
-                json::Dict render_settings = map.at("render_settings").AsDict();
+                const json::Dict& render_settings = map.at("render_settings").AsDict();
                 ProcessRenderSettings(render_settings);
 
                 if (!map.count("routing_settings"))
@@ -227,7 +580,7 @@
                 {
                     throw std::invalid_argument("Key \"routing_settings\" is not map in JSON");
                 }
-                json::Dict router_settings = map.at("routing_settings").AsDict();
+                const json::Dict& router_settings = map.at("routing_settings").AsDict();
                 ProcessRouterSettings(router_settings);
 
                 if (!map.count("serialization_settings"))
@@ -238,19 +591,20 @@
                 {
                     throw std::invalid_argument("Key \"serialization_settings\" is not map in JSON");
                 }
-                json::Dict serialization_settings = map.at("serialization_settings").AsDict();
+                const json::Dict& serialization_settings = map.at("serialization_settings").AsDict();
                 ProcessSerializationSettings(serialization_settings);
             }
 
             void JSONReader::ReadProcessRequestsJSON()
             {
-                json::Node root_node = json::Load(in_).GetRoot();
+                const json::Document document = json::Load(in_);
+                const json::Node& root_node = document.GetRoot();
 
                 if (!root_node.IsDict())
                 {
                     throw std::invalid_argument("Parent node of JSON is not map");
                 }
-                json::Dict map = root_node.AsDict();
+                const json::Dict& map = root_node.AsDict();
 
                 if (!map.count("stat_requests"))
                 {
@@ -260,7 +614,7 @@
                 {
                     throw std::invalid_argument("Key \"stat_requests\" is not array in JSON");
                 }
-                json::Array stat_requests = map.at("stat_requests").AsArray();
+                const json::Array& stat_requests = map.at("stat_requests").AsArray();
                 AddStatRequests(stat_requests);
 
                 if (!map.count("serialization_settings"))
@@ -271,30 +625,125 @@
                 {
                     throw std::invalid_argument("Key \"serialization_settings\" is not map in JSON");
                 }
-                json::Dict serialization_settings = map.at("serialization_settings").AsDict();
+                const json::Dict& serialization_settings = map.at("serialization_settings").AsDict();
                 ProcessSerializationSettings(serialization_settings);
             }
 
+            std::optional<json::Document> JSONReader::LoadNextLine()
+            {
+                while (std::getline(in_, line_))
+                {
+                    if (std::all_of(line_.begin(), line_.end(), [](unsigned char c) { return std::isspace(c); }))
+                    {
+                        continue;
+                    }
+                    // строка должна содержать ровно один документ
+                    return json::Load(std::string_view(line_));
+                }
+                return std::nullopt;
+            }
+
+            void JSONReader::ReadStreamSettingsLine()
+            {
+                const std::optional<json::Document> document = LoadNextLine();
+                if (!document.has_value())
+                {
+                    throw std::invalid_argument("There is no settings line in the request stream");
+                }
+                const json::Node& root_node = document->GetRoot();
+
+                if (!root_node.IsDict())
+                {
+                    throw std::invalid_argument("Settings line of the request stream is not map");
+                }
+                const json::Dict& map = root_node.AsDict();
+
+                if (!map.count("serialization_settings"))
+                {
+                    throw std::invalid_argument("There is no key \"serialization_settings\" in JSON");
+                }
+                if (!map.at("serialization_settings").IsDict())
+                {
+                    throw std::invalid_argument("Key \"serialization_settings\" is not map in JSON");
+                }
+                const json::Dict& serialization_settings = map.at("serialization_settings").AsDict();
+                ProcessSerializationSettings(serialization_settings);
+            }
+
+            bool JSONReader::ReadStatRequestLine()
+            {
+                std::optional<json::Document> document;
+                try
+                {
+                    document = LoadNextLine();
+                }
+                catch (const json::ParsingError& e)
+                {
+                    // строка уже прочитана целиком, следующая разбирается с начала
+                    stat_requests_.push_back(std::make_unique<InvalidRequest>(std::nullopt, e.what()));
+                    return true;
+                }
+                if (!document.has_value())
+                {
+                    return false;
+                }
+                // запросы копируют свои строки и переживают документ
+                try
+                {
+                    AddStatRequest(document->GetRoot());
+                }
+                catch (const std::exception& e)
+                {
+                    stat_requests_.push_back(std::make_unique<InvalidRequest>(FindRequestId(document->GetRoot()), e.what()));
+                }
+                return true;
+            }
+
             void JSONReader::ProcessBaseRequests(const json::Array &arr)
             {
+                // Первый проход добавляет в справочник все остановки. Второй разрешает ссылки на них:
+                // каждое имя из расстояний и маршрутов ищется один раз, а расстояния и маршруты
+                // записываются в справочник сразу через указатели на остановки
+                std::vector<const Core::Stop*> added_stops;
+                size_t distance_count = 0;
                 for (const auto &command : arr)
                 {
                     if (!command.IsDict())
                     {
                         throw std::invalid_argument("Base request in JSON is not map");
                     }
-                    json::Dict current_command = command.AsDict();
+                    const json::Dict& current_command = command.AsDict();
                     if (current_command.at("type").AsString() == "Stop")
                     {
-                        ProcessAddStop(current_command);
+                        added_stops.push_back(ProcessAddStop(current_command));
+                        distance_count += current_command.at("road_distances").AsDict().size();
                     }
-                    else if (current_command.at("type").AsString() == "Bus")
+                    else if (current_command.at("type").AsString() != "Bus")
                     {
-                        ProcessAddBus(current_command);
+                        throw std::invalid_argument("Wrong base request");
                     }
-                    else
+                }
+
+                // Расстояния задаются раньше маршрутов: остановки, упомянутые только в расстояниях,
+                // к этому времени уже добавлены в справочник. Каждое расстояние может добавить и обратное
+                tc_->ReserveDistances(2 * distance_count);
+                auto next_stop = added_stops.begin();
+                for (const auto &command : arr)
+                {
+                    const json::Dict& current_command = command.AsDict();
+                    if (current_command.at("type").AsString() == "Stop")
                     {
-                        throw std::invalid_argument("Wrong base request");
+                        SetDistancesToOtherStops(*next_stop++, current_command);
+                    }
+                }
+
+                std::vector<const Core::Stop*> bus_stops;
+                for (const auto &command : arr)
+                {
+                    const json::Dict& current_command = command.AsDict();
+                    if (current_command.at("type").AsString() == "Bus")
+                    {
+                        ProcessAddBus(current_command, bus_stops);
                     }
                 }
             }
@@ -303,86 +752,131 @@
             {
                 for (const auto &command : arr)
                 {
-                    if (!command.IsDict())
+                    AddStatRequest(command);
+                }
+            }
+
+            void JSONReader::AddStatRequest(const json::Node &command)
+            {
+                if (!command.IsDict())
+                {
+                    throw std::invalid_argument("Stat request in JSON is not map");
+                }
+                const json::Dict& current_request = command.AsDict();
+                if (current_request.at("type").AsString() == "Stop")
+                {
+                    stat_requests_.push_back(std::make_unique<StopInfoRequest>(static_cast<size_t>(current_request.at("id").AsInt()),
+                                                StatRequestType::STOP, std::string{current_request.at("name").AsString()}));
+                }
+                else if (current_request.at("type").AsString() == "Bus")
+                {
+                    stat_requests_.push_back(std::make_unique<BusInfoRequest>(static_cast<size_t>(current_request.at("id").AsInt()),
+                                              StatRequestType::BUS, std::string{current_request.at("name").AsString()}));
+                }
+                else if (current_request.at("type").AsString() == "Map")
+                {
+                    MapRenderRequest map_render_r{static_cast<size_t>(current_request.at("id").AsInt()), StatRequestType::MAP};
+                    stat_requests_.push_back(std::make_unique<MapRenderRequest>(map_render_r));
+                }
+                else if (current_request.at("type").AsString() == "Route")
+                {
+                    stat_requests_.push_back(std::make_unique<RouteRequest>(static_cast<size_t>(current_request.at("id").AsInt()), StatRequestType::ROUTE,
+                    std::string{current_request.at("from").AsString()}, std::string{current_request.at("to").AsString()}));
+                }
+                else if (current_request.at("type").AsString() == "RouteMap")
+                {
+                    stat_requests_.push_back(std::make_unique<RouteMapRequest>(static_cast<size_t>(current_request.at("id").AsInt()),
+                    StatRequestType::ROUTE_MAP, std::string{current_request.at("from").AsString()}, std::string{current_request.at("to").AsString()}));
+                }
+                else if (current_request.at("type").AsString() == "NearestStops")
+                {
+                    std::optional<double> radius;
+                    if (current_request.count("radius"))
                     {
-                        throw std::invalid_argument("Stat request in JSON is not map");
+                        radius = current_request.at("radius").AsDouble();
                     }
-                    json::Dict current_request = command.AsDict();
-                    if (current_request.at("type").AsString() == "Stop")
+                    std::optional<int> count;
+                    if (current_request.count("count"))
                     {
-                        StopInfoRequest stop_info_r{static_cast<size_t>(current_request.at("id").AsInt()),
-                                                    StatRequestType::STOP, current_request.at("name").AsString()};
-                        stat_requests_.push_back(std::make_unique<StopInfoRequest>(stop_info_r));
+                        count = current_request.at("count").AsInt();
                     }
-                    else if (current_request.at("type").AsString() == "Bus")
+                    stat_requests_.push_back(MakeNearestStopsRequest(static_cast<size_t>(current_request.at("id").AsInt()),
+                        {current_request.at("latitude").AsDouble(), current_request.at("longitude").AsDouble()}, radius, count));
+                }
+                else if (current_request.at("type").AsString() == "MapTile")
+                {
+                    // участок задаётся либо тайлом zoom/x/y, либо границами широты и долготы
+                    Render::MapViewport viewport;
+                    if (current_request.count("zoom"))
                     {
-                        BusInfoRequest bus_info_r{static_cast<size_t>(current_request.at("id").AsInt()),
-                                                  StatRequestType::BUS, current_request.at("name").AsString()};
-                        stat_requests_.push_back(std::make_unique<BusInfoRequest>(bus_info_r));
+                        viewport = Render::GetTileViewport(current_request.at("zoom").AsInt(),
+                                                           current_request.at("x").AsInt(), current_request.at("y").AsInt());
                     }
-                    else if (current_request.at("type").AsString() == "Map")
+                    else
                     {
-                        MapRenderRequest map_render_r{static_cast<size_t>(current_request.at("id").AsInt()), StatRequestType::MAP};
-                        stat_requests_.push_back(std::make_unique<MapRenderRequest>(map_render_r));
+                        viewport.min = {current_request.at("min_latitude").AsDouble(), current_request.at("min_longitude").AsDouble()};
+                        viewport.max = {current_request.at("max_latitude").AsDouble(), current_request.at("max_longitude").AsDouble()};
                     }
-                    else if (current_request.at("type").AsString() == "Route")
+                    if (current_request.count("width"))
                     {
-                        RouteRequest route_r{static_cast<size_t>(current_request.at("id").AsInt()), StatRequestType::ROUTE,
-                        current_request.at("from").AsString(), current_request.at("to").AsString()};
-                        stat_requests_.push_back(std::make_unique<RouteRequest>(route_r));
+                        viewport.width = current_request.at("width").AsDouble();
                     }
-                    else
+                    if (current_request.count("height"))
                     {
-                        throw std::invalid_argument("Wrong stat request");
+                        viewport.height = current_request.at("height").AsDouble();
                     }
+                    stat_requests_.push_back(MakeMapTileRequest(static_cast<size_t>(current_request.at("id").AsInt()), viewport));
+                }
+                else if (current_request.at("type").AsString() == "Reload")
+                {
+                    stat_requests_.push_back(std::make_unique<ReloadRequest>(static_cast<size_t>(current_request.at("id").AsInt()),
+                                                                             StatRequestType::RELOAD));
+                }
+                else
+                {
+                    throw std::invalid_argument("Wrong stat request");
                 }
             }
 
-            void JSONReader::ProcessAddStop(const json::Dict &add_stop_command)
+            const Core::Stop* JSONReader::ProcessAddStop(const json::Dict &add_stop_command)
             {
-                std::vector<std::pair<std::string, double>> distances_to_other_stops;
                 if (!add_stop_command.at("road_distances").IsDict())
                 {
                     throw std::invalid_argument("Add stop request is not map");
                 }
-                json::Dict distances = add_stop_command.at("road_distances").AsDict();
-                for (const auto &[other_stop, distance] : distances)
-                {
-                    distances_to_other_stops.push_back({other_stop, distance.AsDouble()});
-                }
-
-                AddStopRequest new_add_stop_request{BaseRequestType::STOP, add_stop_command.at("name").AsString(), {add_stop_command.at("latitude").AsDouble(), add_stop_command.at("longitude").AsDouble()}, distances_to_other_stops};
-
-                commands_.base_requests.add_stop.push_back(std::move(new_add_stop_request));
+                return tc_->AddStop(add_stop_command.at("name").AsString(),
+                                   detail::Coordinates{add_stop_command.at("latitude").AsDouble(), add_stop_command.at("longitude").AsDouble()});
             }
 
-            void JSONReader::ProcessAddBus(const json::Dict &add_bus_command)
+            void JSONReader::ProcessAddBus(const json::Dict &add_bus_command, std::vector<const Core::Stop*> &stops)
             {
-                std::vector<std::string> stops;
                 if (!add_bus_command.at("stops").IsArray())
                 {
                     throw std::invalid_argument("Add bus request is not map");
                 }
-                for (const auto &stop_name : add_bus_command.at("stops").AsArray())
+                const json::Array& stop_names = add_bus_command.at("stops").AsArray();
+                stops.clear();
+                stops.reserve(stop_names.size());
+                for (const auto &stop_name : stop_names)
                 {
-                    stops.push_back(stop_name.AsString());
+                    stops.push_back(tc_->FindStop(stop_name.AsString()));
                 }
 
                 bool is_roundtrip = add_bus_command.at("is_roundtrip").AsBool();
 
-                AddBusRequest new_add_bus_request{BaseRequestType::BUS, add_bus_command.at("name").AsString(), std::move(stops), is_roundtrip};
-                commands_.base_requests.add_bus.push_back(std::move(new_add_bus_request));
+                tc_->AddBus(add_bus_command.at("name").AsString(), stops, is_roundtrip);
             }
 
-            void JSONReader::SetDistancesToOtherStops(std::string_view start, const std::vector<std::pair<std::string, double>> &distances_to_other_stops)
+            void JSONReader::SetDistancesToOtherStops(const Core::Stop *start, const json::Dict &add_stop_command)
             {
-                for (const auto &[other_stop_name, distance] : distances_to_other_stops)
+                for (const auto &[other_stop_name, distance] : add_stop_command.at("road_distances").AsDict())
                 {
-                    if (!tc_.FindStop(other_stop_name))
+                    const Core::Stop* other_stop = tc_->FindStop(other_stop_name);
+                    if (!other_stop)
                     {
-                        tc_.AddStop(other_stop_name, {}); // adding stop to be filled in the future
+                        other_stop = tc_->AddStop(other_stop_name, {}); // adding stop to be filled in the future
                     }
-                    tc_.SetDistanceBetweenStops(tc_.FindStop(start), tc_.FindStop(other_stop_name), distance);
+                    tc_->SetDistanceBetweenStops(start, other_stop, distance.AsDouble());
                 }
             }
 
@@ -407,11 +901,24 @@
                 render_settings_.underlayer_color = ParseColorFromJSON(dict.at("underlayer_color"));
                 render_settings_.underlayer_width = dict.at("underlayer_width").AsDouble();
 
-                json::Array color_p = dict.at("color_palette").AsArray();
+                const json::Array& color_p = dict.at("color_palette").AsArray();
                 for (const auto &node : color_p)
                 {
                     render_settings_.color_palette.push_back(ParseColorFromJSON(node));
                 }
+
+                if (dict.count("simplification_tolerance"))
+                {
+                    render_settings_.simplification_tolerance = dict.at("simplification_tolerance").AsDouble();
+                    if (render_settings_.simplification_tolerance < 0)
+                    {
+                        throw std::invalid_argument("Negative simplification tolerance in render settings");
+                    }
+                }
+                if (dict.count("label_culling"))
+                {
+                    render_settings_.label_culling = dict.at("label_culling").AsBool();
+                }
             }
 
             void JSONReader::ProcessRouterSettings(const json::Dict& dict)
@@ -422,18 +929,18 @@
 
             void JSONReader::ProcessSerializationSettings(const json::Dict& dict)
             {
-                serializatoin_settings_.file = dict.at("file").AsString();
+                serializatoin_settings_.file = std::string{dict.at("file").AsString()};
             }
 
             svg::Color JSONReader::ParseColorFromJSON(const json::Node &node) const
             {
                 if (node.IsString())
                 {
-                    return node.AsString();
+                    return std::string{node.AsString()};
                 }
                 if (node.IsArray())
                 {
-                    json::Array arr = node.AsArray();
+                    const json::Array& arr = node.AsArray();
                     if (arr.size() == 3)
                     {
                         return svg::Rgb{static_cast<uint8_t>(arr[0].AsInt()), static_cast<uint8_t>(arr[1].AsInt()),
@@ -500,7 +1007,8 @@
 
                 for (const AddBusCommand &bus_command : queue_.bus_commands)
                 {
-                    tc_.AddBus(std::move(bus_command.name), std::move(bus_command.stops), bus_command.is_roundtrip);
+                    const std::vector<std::string_view> stops(bus_command.stops.begin(), bus_command.stops.end());
+                    tc_.AddBus(bus_command.name, stops, bus_command.is_roundtrip);
                 }
             }
 
@@ -5,6 +5,14 @@
 #include "request_handler.h"
 #include "json_builder.h"
 
+#include <cstddef>
+#include <memory_resource>
+
+namespace stat_serialization
+{
+    class StatResponse;
+}
+
 /*
  * Здесь можно разместить код наполнения транспортного справочника данными из JSON,
  * а также код обработки запросов к базе и формирование массива ответов в формате JSON
@@ -15,44 +23,17 @@ namespace TransportInformator
 
 namespace Input
 {
-    enum class BaseRequestType
-    {
-        BUS,
-        STOP,
-    };
-
-    //Requests forming the database
-    struct BaseRequest
-    {
-        BaseRequest(BaseRequestType new_type, const std::string& new_name);
-        BaseRequestType type;
-        std::string name;
-
-        virtual ~BaseRequest() = default;
-
-    };
-
-    struct AddBusRequest : public BaseRequest
-    {
-        AddBusRequest(BaseRequestType new_type, const std::string& new_name, const std::vector<std::string>& new_stops, bool is_roundtrip);
-        std::vector<std::string> stops;
-        bool is_roundtrip;
-    };
-
-    struct AddStopRequest : public BaseRequest
-    {
-        AddStopRequest(BaseRequestType new_type, const std::string& new_name, 
-        detail::Coordinates new_coords, const std::vector<std::pair<std::string, double>>& distances);
-        detail::Coordinates coords;
-        std::vector<std::pair<std::string, double>> distances_to_other_stops;
-    };
-
     enum class StatRequestType
     {
         BUS,
         STOP,
         MAP,
         ROUTE,
+        NEAREST_STOPS,
+        RELOAD,
+        MAP_TILE,
+        ROUTE_MAP,
+        INVALID,
     };
 
     class JSONReader;
@@ -66,14 +47,33 @@ namespace Input
 
         virtual ~StatRequest() = default;
         virtual json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) = 0;
-        
+        // Тот же ответ в двоичном виде (см. binary_reader.h); id ответа заполняет вызывающий
+        virtual void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) = 0;
+        // Дописывает в key тип и параметры запроса: у одинаковых запросов ключи равны, и ответ на них
+        // считается один раз. false, если ответ нельзя переиспользовать — тогда key не меняется
+        virtual bool AppendCacheKey(std::string& key) const;
+    };
+
+    // Сколько запросов было в пакете и на сколько из них ответ посчитан заново,
+    // а не скопирован из ответа на такой же запрос
+    struct StatBatchStats
+    {
+        size_t requests = 0;
+        size_t computed = 0;
     };
 
+    // Для каждого запроса — номер первого такого же запроса в пакете или его собственный номер
+    std::vector<size_t> FindRepeatedRequests(const std::vector<std::unique_ptr<StatRequest>>& requests);
+
+    std::ostream& operator<<(std::ostream& out, const StatBatchStats& stats);
+
     struct BusInfoRequest : public StatRequest
     {
         BusInfoRequest(size_t new_id, StatRequestType new_type, std::string new_name);
         std::string name;
         json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
     };
 
     struct StopInfoRequest : public StatRequest
@@ -81,12 +81,16 @@ namespace Input
         StopInfoRequest(size_t new_id, StatRequestType new_type, std::string new_name);
         std::string name;
         json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
     };
     
     struct MapRenderRequest : public StatRequest
     {
         MapRenderRequest(size_t new_id, StatRequestType new_type);
         json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
     };
 
     struct RouteRequest : public StatRequest
@@ -95,48 +99,128 @@ namespace Input
         std::string from;
         std::string to;
         json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
     };
 
-    struct DBCommands
+    // Поездка из from в to, нарисованная поверх полной карты: только её участки и остановки
+    struct RouteMapRequest : public StatRequest
     {
-        struct BaseRequests
-        {
-            std::vector<AddBusRequest> add_bus;
-            std::vector<AddStopRequest> add_stop;
-        };
-        BaseRequests base_requests;
-        std::vector<StatRequest> stat_requests;
+        RouteMapRequest(size_t new_id, StatRequestType new_type, std::string name_from, std::string name_to);
+        std::string from;
+        std::string to;
+        json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
+    };
+
+    struct NearestStopsRequest : public StatRequest
+    {
+        NearestStopsRequest(size_t new_id, StatRequestType new_type, detail::Coordinates new_center,
+                            std::optional<double> new_radius, std::optional<size_t> new_count);
+        detail::Coordinates center;
+        std::optional<double> radius;
+        std::optional<size_t> count;
+        json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
+    };
+
+    struct MapTileRequest : public StatRequest
+    {
+        MapTileRequest(size_t new_id, StatRequestType new_type, Render::MapViewport new_viewport);
+        Render::MapViewport viewport;
+        json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+        bool AppendCacheKey(std::string& key) const override;
+    };
+
+    // Создают запросы из уже прочитанных параметров и проверяют их одинаково для JSON и двоичного ввода.
+    // Неверные параметры — std::invalid_argument
+    // radius и count — пределы поиска, нужен хотя бы один из них
+    std::unique_ptr<NearestStopsRequest> MakeNearestStopsRequest(size_t id, detail::Coordinates center,
+                                                                 std::optional<double> radius, std::optional<int> count);
+    // viewport — тайл из GetTileViewport или участок, заданный границами; размеры изображения необязательны
+    std::unique_ptr<MapTileRequest> MakeMapTileRequest(size_t id, Render::MapViewport viewport);
+
+    // Управляющий запрос: запускает фоновую перезагрузку базы и сообщает номер текущего поколения
+    struct ReloadRequest : public StatRequest
+    {
+        ReloadRequest(size_t new_id, StatRequestType new_type);
+        json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
+    };
+
+    // Строка построчного режима, из которой не удалось прочитать запрос. Ответ на неё — сообщение об ошибке
+    // с request_id, если id удалось прочитать, чтобы одна плохая строка не останавливала обработку остальных
+    struct InvalidRequest : public StatRequest
+    {
+        InvalidRequest(std::optional<size_t> new_id, std::string new_error_message);
+        bool has_id;
+        std::string error_message;
+        json::Node Process(JSONReader& jreader, ReqHandler::RequestHandler& rh) override;
+        void ProcessBinary(ReqHandler::RequestHandler& rh, stat_serialization::StatResponse& response) override;
     };
 
     class JSONReader
     {
         public:
-        JSONReader(Core::TransportCatalogue& tc, std::istream& in);
+        // Ответы на запросы выводятся в стиле output_style
+        JSONReader(Core::TransportCatalogue& tc, std::istream& in, json::PrintStyle output_style = json::PrintStyle::PRETTY);
+        // Только для запросов к готовой базе (process_requests, serve, stream): ReadMakeBaseJSON недоступен
+        explicit JSONReader(std::istream& in, json::PrintStyle output_style = json::PrintStyle::PRETTY);
         void ReadMakeBaseJSON();
         void ReadProcessRequestsJSON();
         void Print(std::ostream &out, json::Document doc_to_print);
         Render::RenderSettings GetRenderSettings() const;
         Router::TransportRouterParameters GetRouterSettings() const;
         Serialize::SerializationParameters GetSerializationSettings() const;
+        // Отвечает на прочитанные запросы и забывает их, после чего можно читать следующий документ.
+        // На повторяющиеся запросы пакета выводится копия первого ответа со своим request_id
         void SendStatRequests(ReqHandler::RequestHandler& rh);
+        // Повторы в пакете, на который в последний раз отвечал SendStatRequests
+        StatBatchStats GetLastBatchStats() const;
+
+        // Построчный режим (NDJSON): первая непустая строка ввода — объект с serialization_settings,
+        // каждая следующая — один запрос из stat_requests, а каждый ответ выводится одной строкой
+        void ReadStreamSettingsLine();
+        // Читает запрос из следующей непустой строки; false, если ввод закончился.
+        // Строка, которая не разбирается или не содержит правильного запроса, становится InvalidRequest
+        bool ReadStatRequestLine();
+        // Отвечает на прочитанные запросы, выводя каждый ответ отдельной строкой, и забывает их.
+        // Ошибка при ответе на запрос выводится вместо ответа и не прерывает обработку
+        void SendStatRequestLines(ReqHandler::RequestHandler& rh);
+
+        // Экранированная для JSON карта; экранирование выполняется один раз на каждую новую карту
+        json::RawJson GetEscapedMap(const std::shared_ptr<const std::string>& map_svg);
+
+        // Память для ответа на текущий запрос (json::Builder в StatRequest::Process).
+        // Она освобождается целиком перед следующим ответом, поэтому ответ не хранится дольше
+        std::pmr::memory_resource* GetResponseResource();
 
         private:
-        Core::TransportCatalogue &tc_;
+        // справочник для base_requests; nullptr у читателя только запросов
+        Core::TransportCatalogue* tc_ = nullptr;
         std::istream& in_;
+        json::PrintStyle output_style_;
 
         friend class BusInfoRequest;
         friend class StopInfoRequest;
         friend class MapRenderRequest;
 
+        // Запросы base_requests сразу записываются в справочник, без промежуточных копий
         void ProcessBaseRequests(const json::Array& arr);
-        void ProcessAddStop(const json::Dict& add_stop_command);
-        void ProcessAddBus(const json::Dict& add_bus_command);
-
-        void SetDistancesToOtherStops(std::string_view start, const std::vector<std::pair<std::string, double>>& distances_to_other_stops);
-
-        void SendBaseRequests();
+        const Core::Stop* ProcessAddStop(const json::Dict& add_stop_command);
+        // stops — буфер для остановок маршрута, общий для всех маршрутов
+        void ProcessAddBus(const json::Dict& add_bus_command, std::vector<const Core::Stop*>& stops);
+        void SetDistancesToOtherStops(const Core::Stop* start, const json::Dict& add_stop_command);
 
         void AddStatRequests(const json::Array& arr);
+        void AddStatRequest(const json::Node& command);
+
+        // Разбирает следующую непустую строку ввода; пусто, если ввод закончился
+        std::optional<json::Document> LoadNextLine();
+        std::string line_;
 
         
 
@@ -146,8 +230,6 @@ namespace Input
         std::vector<std::unique_ptr<StatRequest>> stat_requests_;
         //std::vector<json::Node> db_answers_;
 
-        DBCommands commands_;
-
         Render::RenderSettings render_settings_;
 
         void ProcessRouterSettings(const json::Dict& router_settings);
@@ -156,7 +238,14 @@ namespace Input
 
         void ProcessSerializationSettings(const json::Dict& serialization_settings);
         Serialize::SerializationParameters serializatoin_settings_;
-        
+
+        std::shared_ptr<const std::string> cached_map_source_;
+        json::RawJson cached_map_json_;
+
+        StatBatchStats last_batch_stats_;
+
+        std::vector<std::byte> response_buffer_;
+        std::pmr::monotonic_buffer_resource response_arena_;
     };
 
     class InputReader
@@ -1,25 +1,123 @@
+#include <atomic>
+#include <csignal>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string_view>
+#include <thread>
+
+#ifdef SIGHUP
+#include <pthread.h>
+#endif
 
 #include "transport_catalogue.h"
 #include "request_handler.h"
 #include "json_reader.h"
+#include "binary_reader.h"
+#include "base_reloader.h"
 
 using namespace std::literals;
 
+namespace {
+
+#ifdef SIGHUP
+
+// Запрещает доставку SIGHUP обработчикам. Вызывается до создания потоков,
+// чтобы они унаследовали маску и сигнал дожидался ReloadSignalWatcher
+void BlockReloadSignal() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+// Поток, который ждёт SIGHUP и сразу запускает перезагрузку базы,
+// даже если процесс в это время ждёт ввода
+class ReloadSignalWatcher {
+public:
+    explicit ReloadSignalWatcher(TransportInformator::Service::BaseReloader& reloader)
+        : thread_([this, &reloader] { Watch(reloader); }) {
+    }
+
+    ReloadSignalWatcher(const ReloadSignalWatcher&) = delete;
+    ReloadSignalWatcher& operator=(const ReloadSignalWatcher&) = delete;
+
+    ~ReloadSignalWatcher() {
+        // сигнал будит sigwait, а флаг говорит, что перезагружать базу уже не нужно
+        stopping_ = true;
+        pthread_kill(thread_.native_handle(), SIGHUP);
+        thread_.join();
+    }
+
+private:
+    void Watch(TransportInformator::Service::BaseReloader& reloader) {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGHUP);
+        int signal = 0;
+        while (sigwait(&signals, &signal) == 0 && !stopping_) {
+            reloader.StartReload();
+        }
+    }
+
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+#else
+
+void BlockReloadSignal() {
+}
+
+// Без SIGHUP базу перезагружает только запрос Reload
+class ReloadSignalWatcher {
+public:
+    explicit ReloadSignalWatcher(TransportInformator::Service::BaseReloader&) {
+    }
+};
+
+#endif
+
+}
+
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve|stream] [--format=pretty|compact|binary] [--stats]\n"sv;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2 || argc > 4) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
 
+    // Ответы по умолчанию выводятся с отступами; компактный вывод короче и быстрее для программ-клиентов
+    json::PrintStyle output_style = json::PrintStyle::PRETTY;
+    // Двоичные запросы и ответы (stat_requests.proto) есть только у process_requests
+    bool binary_format = false;
+    // Сводка о повторах запросов в каждом пакете (process_requests и serve) выводится в stderr
+    bool print_stats = false;
+    // make_base ничего не выводит, и формат вывода ему задавать не нужно
+    const bool has_output = mode != "make_base"sv;
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view option(argv[i]);
+        if (option == "--stats"sv && (mode == "process_requests"sv || mode == "serve"sv)) {
+            print_stats = true;
+        } else if (option == "--format=compact"sv && has_output) {
+            output_style = json::PrintStyle::COMPACT;
+        } else if (option == "--format=binary"sv && mode == "process_requests"sv) {
+            binary_format = true;
+        } else if (option != "--format=pretty"sv || !has_output) {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Потоки не синхронизируются с stdio: разбор JSON читает ввод кусками прямо из буфера std::cin
+    std::ios::sync_with_stdio(false);
+
     if (mode == "make_base"sv) {
 
         TransportInformator::Core::TransportCatalogue tc;
@@ -27,21 +125,84 @@ int main(int argc, char* argv[]) {
         jsonreader.ReadMakeBaseJSON();
         TransportInformator::Serialize::Serializator serializer{tc, jsonreader.GetSerializationSettings()};
         TransportInformator::Router::TransportRouter router(tc, jsonreader.GetRouterSettings());
+        // Карта не зависит от запросов, поэтому отрисовывается один раз и сохраняется вместе с базой
+        TransportInformator::Render::MapRenderer renderer(jsonreader.GetRenderSettings(), tc.GetAllNonEmptyStopsCoords());
+        TransportInformator::ReqHandler::RequestHandler handler(tc, renderer, router);
         serializer.SerializeToFile(jsonreader.GetRenderSettings(),
-                                   jsonreader.GetRouterSettings(), router);
+                                   jsonreader.GetRouterSettings(), router, handler.RenderMapSvg());
+
+    } else if (mode == "process_requests"sv && binary_format) {
+
+        TransportInformator::Input::BinaryReader binary_reader{std::cin};
+        binary_reader.ReadProcessRequests();
+        const auto generation = TransportInformator::Service::LoadBaseGeneration(binary_reader.GetSerializationSettings(), 1);
+
+        binary_reader.SendStatRequests(*generation->handler, std::cout);
+        if (print_stats) {
+            std::cerr << binary_reader.GetLastBatchStats() << std::endl;
+        }
 
     } else if (mode == "process_requests"sv) {
 
-        TransportInformator::Core::TransportCatalogue tc;
-        TransportInformator::Input::JSONReader jsonreader{tc, std::cin};
+        TransportInformator::Input::JSONReader jsonreader{std::cin, output_style};
         jsonreader.ReadProcessRequestsJSON();
-        TransportInformator::Serialize::Serializator serializer{tc, jsonreader.GetSerializationSettings()};
-        TransportInformator::Router::TransportRouter router = serializer.UnserializeFromFile();
+        const auto generation = TransportInformator::Service::LoadBaseGeneration(jsonreader.GetSerializationSettings(), 1);
 
-        TransportInformator::Render::MapRenderer renderer(serializer.GetRenderSettings(), tc.GetAllNonEmptyStopsCoords());
-        TransportInformator::ReqHandler::RequestHandler handler(tc, renderer, router);
+        jsonreader.SendStatRequests(*generation->handler);
+        // сводка о повторах запросов не смешивается с ответами в stdout
+        if (print_stats) {
+            std::cerr << jsonreader.GetLastBatchStats() << std::endl;
+        }
+
+    } else if (mode == "serve"sv) {
+
+        // Долгоживущий режим: документы с запросами читаются из stdin один за другим.
+        // База загружается по настройкам первого документа и перезагружается
+        // по запросу Reload или сразу по приходе сигнала SIGHUP, не прерывая обработку запросов.
+        BlockReloadSignal();
+        TransportInformator::Input::JSONReader jsonreader{std::cin, output_style};
+        std::unique_ptr<TransportInformator::Service::BaseReloader> reloader;
+        // пока база не загружена, перезагружать нечего
+        std::optional<ReloadSignalWatcher> signal_watcher;
+
+        while (std::cin >> std::ws && std::cin.peek() != std::char_traits<char>::eof()) {
+            jsonreader.ReadProcessRequestsJSON();
+            if (!reloader) {
+                reloader = std::make_unique<TransportInformator::Service::BaseReloader>(jsonreader.GetSerializationSettings());
+                signal_watcher.emplace(*reloader);
+            }
+
+            const auto generation = reloader->GetCurrent();
+            jsonreader.SendStatRequests(*generation->handler);
+            std::cout << std::endl;
+            if (print_stats) {
+                std::cerr << jsonreader.GetLastBatchStats() << std::endl;
+            }
+        }
+
+    } else if (mode == "stream"sv) {
+
+        // Построчный режим (NDJSON): после строки с настройками базы каждая строка ввода — один запрос,
+        // и ответ на него выводится одной строкой, не дожидаясь конца ввода. Ответы всегда компактны
+        BlockReloadSignal();
+        TransportInformator::Input::JSONReader jsonreader{std::cin, json::PrintStyle::COMPACT};
+        jsonreader.ReadStreamSettingsLine();
+        TransportInformator::Service::BaseReloader reloader(jsonreader.GetSerializationSettings());
+        ReloadSignalWatcher signal_watcher(reloader);
+
+        while (true) {
+            // Пока запросы идут подряд, ответы копятся в буфере вывода и уходят клиенту,
+            // как только читать больше нечего и процесс начнёт ждать ввода
+            if (std::cin.rdbuf()->in_avail() <= 0) {
+                std::cout.flush();
+            }
+            if (!jsonreader.ReadStatRequestLine()) {
+                break;
+            }
 
-        jsonreader.SendStatRequests(handler);
+            const auto generation = reloader.GetCurrent();
+            jsonreader.SendStatRequestLines(*generation->handler);
+        }
 
     } else {
         PrintUsage();
@@ -1,6 +1,16 @@
 #include "map_renderer.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
  * Визуализация маршрутов вам понадобится во второй части итогового проекта.
@@ -18,6 +28,110 @@ namespace TransportInformator
             return std::abs(value) < EPSILON;
         }
 
+        namespace
+        {
+            // Столько объектов одного прохода рисуется одной задачей при параллельной отрисовке карты
+            const size_t RENDER_CHUNK_SIZE = 1024;
+            // Карту с меньшим числом объектов быстрее нарисовать в текущем потоке, чем запускать новые
+            const size_t PARALLEL_RENDER_MIN_OBJECTS = 4 * RENDER_CHUNK_SIZE;
+
+            // Выполняет task(i) для всех i из [0, count) на thread_count потоках, включая текущий.
+            // Если новый поток запустить не удалось, задачи доделывают уже запущенные потоки и текущий.
+            // Исключение из любой задачи пробрасывается после завершения всех потоков.
+            template <typename Task>
+            void RunInParallel(size_t count, size_t thread_count, Task task)
+            {
+                std::atomic<size_t> next_task{0};
+                std::mutex error_mutex;
+                std::exception_ptr error;
+
+                auto worker = [&]()
+                {
+                    for (size_t i = next_task++; i < count; i = next_task++)
+                    {
+                        try
+                        {
+                            task(i);
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard guard(error_mutex);
+                            if (!error)
+                            {
+                                error = std::current_exception();
+                            }
+                        }
+                    }
+                };
+
+                std::vector<std::thread> threads;
+                threads.reserve(thread_count - 1);
+                for (size_t i = 1; i < thread_count; ++i)
+                {
+                    try
+                    {
+                        threads.emplace_back(worker);
+                    }
+                    catch (const std::system_error&)
+                    {
+                        break;
+                    }
+                }
+                worker();
+                for (std::thread& thread : threads)
+                {
+                    thread.join();
+                }
+
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            // Приблизительные размеры символа шрифта Verdana в долях размера шрифта
+            const double LABEL_CHAR_WIDTH = 0.64;
+            const double LABEL_BOLD_CHAR_WIDTH = 0.71;
+            const double LABEL_ASCENT = 0.8;
+            const double LABEL_DESCENT = 0.2;
+
+            const uint8_t START_LABEL = 1;
+            const uint8_t FINISH_LABEL = 2;
+
+            // Прямоугольник, который займёт надпись с подложкой; ширина оценивается по числу символов UTF-8
+            ScreenBox GetLabelBox(std::string_view text, svg::Point position, const std::array<double, 2>& offset,
+                                  size_t font_size, double char_width, double underlayer_width)
+            {
+                const size_t char_count = std::count_if(text.begin(), text.end(), [](char c)
+                {
+                    return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+                });
+                const double x = position.x + offset[0];
+                const double y = position.y + offset[1];
+                const double margin = underlayer_width / 2;
+                return {{x - margin, y - font_size * LABEL_ASCENT - margin},
+                        {x + char_count * font_size * char_width + margin, y + font_size * LABEL_DESCENT + margin}};
+            }
+
+            // Обходит остановки линии маршрута в порядке отрисовки:
+            // некольцевой маршрут проходится до конечной и обратно
+            template <typename Callback>
+            void ForEachBusPathPoint(const BusDrawingInfo& bus_info, Callback callback)
+            {
+                for (const Core::Stop* stop : bus_info.stops)
+                {
+                    callback(stop);
+                }
+                if (!bus_info.is_roundtrip)
+                {
+                    for (auto it = std::next(bus_info.stops.rbegin()); it != bus_info.stops.rend(); ++it)
+                    {
+                        callback(*it);
+                    }
+                }
+            }
+        }
+
         // points_begin и points_end задают начало и конец интервала элементов geo::Coordinates
         template <typename PointInputIt>
         SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_end,
@@ -78,6 +192,99 @@ namespace TransportInformator
             }
         }
 
+        std::vector<svg::Point> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance)
+        {
+            if (points.size() < 3)
+            {
+                return points;
+            }
+
+            // Квадрат расстояния от точки до отрезка: у кольцевого маршрута концы совпадают,
+            // поэтому расстояние до прямой здесь не подходит
+            auto squared_distance = [](svg::Point point, svg::Point from, svg::Point to)
+            {
+                const double dx = to.x - from.x;
+                const double dy = to.y - from.y;
+                const double length = dx * dx + dy * dy;
+                double t = 0;
+                if (length > 0)
+                {
+                    t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0., 1.);
+                }
+                const double nearest_x = from.x + t * dx - point.x;
+                const double nearest_y = from.y + t * dy - point.y;
+                return nearest_x * nearest_x + nearest_y * nearest_y;
+            };
+
+            const double squared_tolerance = tolerance * tolerance;
+            std::vector<bool> keep(points.size(), false);
+            keep.front() = keep.back() = true;
+
+            // Отрезки ломаной, ещё не проверенные на отклонение; стек вместо рекурсии
+            std::vector<std::pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+            while (!ranges.empty())
+            {
+                const auto [first, last] = ranges.back();
+                ranges.pop_back();
+
+                double max_distance = 0;
+                size_t farthest = first;
+                for (size_t i = first + 1; i < last; ++i)
+                {
+                    const double distance = squared_distance(points[i], points[first], points[last]);
+                    if (distance > max_distance)
+                    {
+                        max_distance = distance;
+                        farthest = i;
+                    }
+                }
+
+                if (max_distance > squared_tolerance)
+                {
+                    keep[farthest] = true;
+                    ranges.push_back({first, farthest});
+                    ranges.push_back({farthest, last});
+                }
+            }
+
+            std::vector<svg::Point> result;
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                if (keep[i])
+                {
+                    result.push_back(points[i]);
+                }
+            }
+            return result;
+        }
+
+        MapViewport GetTileViewport(int zoom, int x, int y)
+        {
+            // Больше уровней веб-карты не используют, а сдвиг на 31 бит уже переполняет int
+            if (zoom < 0 || zoom > 30)
+            {
+                throw std::invalid_argument("Tile zoom must be in range [0, 30]");
+            }
+            const int tiles_count = 1 << zoom;
+            if (x < 0 || x >= tiles_count || y < 0 || y >= tiles_count)
+            {
+                throw std::invalid_argument("Tile coordinates are out of range for the zoom level");
+            }
+
+            // Проекция Меркатора: долгота делится на тайлы равномерно, широта — по гиперболическому синусу
+            const double pi = std::acos(-1.);
+            auto tile_lng = [tiles_count](int tile_x)
+            {
+                return static_cast<double>(tile_x) / tiles_count * 360. - 180.;
+            };
+            auto tile_lat = [tiles_count, pi](int tile_y)
+            {
+                return std::atan(std::sinh(pi * (1. - 2. * tile_y / tiles_count))) * 180. / pi;
+            };
+
+            return {{tile_lat(y + 1), tile_lng(x)}, {tile_lat(y), tile_lng(x + 1)}, std::nullopt, std::nullopt};
+        }
+
         // Проецирует широту и долготу в координаты внутри SVG-изображения
         svg::Point SphereProjector::operator()(TransportInformator::detail::Coordinates coords) const
         {
@@ -91,98 +298,122 @@ namespace TransportInformator
         projector_{all_coords.begin(), all_coords.end(), settings_.width, settings_.height, settings_.padding}
         {}
 
-        void MapRenderer::DrawBus(const BusDrawingInfo& bus_info)
+        void MapRenderer::DrawBus(const BusDrawingInfo& bus_info, svg::ObjectContainer& target)
         {
-            svg::Polyline new_bus;
+            DrawBusPath(bus_info, *bus_color_it, target);
+
+            bus_to_color_[bus_info.name] = *bus_color_it;
+            MoveCurrentBusColor();
+        }
 
-            if (bus_info.is_roundtrip)
+        void MapRenderer::DrawBusLabel(const BusDrawingInfo& bus_info, svg::ObjectContainer& target)
+        {
+            DrawBusLabels(bus_info, bus_to_color_.at(bus_info.name), target);
+        }
+
+        void MapRenderer::DrawBusPath(const BusDrawingInfo& bus_info, const svg::Color& color, svg::ObjectContainer& target) const
+        {
+            svg::Polyline new_bus;
+            if (settings_.simplification_tolerance > 0)
             {
-                for (const auto& stop_coords : bus_info.stops_coords)
+                // Линия без заливки с круглыми стыками выглядит одинаково, пройдена она один раз или туда и обратно
+                std::vector<svg::Point> points;
+                points.reserve(bus_info.stops.size());
+                for (const Core::Stop* stop : bus_info.stops)
                 {
-                    new_bus.AddPoint(projector_(stop_coords));
+                    points.push_back(GetStopPoint(stop));
                 }
-            } else {
-                for (const auto& stop_coords : bus_info.stops_coords)
+                for (const svg::Point point : SimplifyPolyline(points, settings_.simplification_tolerance))
                 {
-                    new_bus.AddPoint(projector_(stop_coords));
+                    new_bus.AddPoint(point);
                 }
-                
-                for (auto it = std::next(bus_info.stops_coords.end(), -2); it != std::next(bus_info.stops_coords.begin(), -1); --it)
+            }
+            else
+            {
+                ForEachBusPathPoint(bus_info, [this, &new_bus](const Core::Stop* stop)
                 {
-                    new_bus.AddPoint(projector_(*it));
-                }
+                    new_bus.AddPoint(GetStopPoint(stop));
+                });
             }
-            
-            
-            new_bus.SetStrokeColor(*bus_color_it).SetFillColor(svg::NoneColor).SetStrokeWidth(settings_.line_width);
-            new_bus.SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-
-
-            doc_.Add(new_bus);
-
-            bus_to_color_[bus_info.name] = *bus_color_it;
-            MoveCurrentBusColor();
+            DrawBusLine(std::move(new_bus), color, target);
         }
 
-        void MapRenderer::DrawBusLabel(const BusDrawingInfo& bus_info)
+        void MapRenderer::DrawBusLabels(const BusDrawingInfo& bus_info, const svg::Color& color, svg::ObjectContainer& target) const
         {
-            svg::Text start_label;
-
-            start_label.SetPosition(projector_(bus_info.start_coords)).SetOffset({settings_.bus_label_offset[0], settings_.bus_label_offset[1]});
-            start_label.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold");
-            start_label.SetData(static_cast<std::string>(bus_info.name));
+            const auto hidden_it = hidden_bus_labels_.find(bus_info.name);
+            const uint8_t hidden = hidden_it != hidden_bus_labels_.end() ? hidden_it->second : 0;
 
-            svg::Text start_label_underlayer = start_label;
+            const Core::Stop* start = bus_info.stops.front();
+            const Core::Stop* finish = bus_info.stops.back();
+            if (!(hidden & START_LABEL))
+            {
+                DrawBusLabelAt(bus_info.name, GetStopPoint(start), color, target);
+            }
+            if (start->coords != finish->coords && !(hidden & FINISH_LABEL))
+            {
+                DrawBusLabelAt(bus_info.name, GetStopPoint(finish), color, target);
+            }
+        }
 
-            start_label_underlayer.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color);
-            start_label_underlayer.SetStrokeWidth(settings_.underlayer_width);
-            start_label_underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+        void MapRenderer::DrawStopSymbol(const Core::Stop* stop, svg::ObjectContainer& target)
+        {
+            DrawStopSymbolAt(GetStopPoint(stop), target);
+        }
 
-            start_label.SetFillColor(bus_to_color_.at(bus_info.name));
+        void MapRenderer::DrawStopLabel(const Core::Stop* stop, svg::ObjectContainer& target)
+        {
+            if (!IsStopLabelHidden(stop))
+            {
+                DrawStopLabelAt(stop->name, GetStopPoint(stop), target);
+            }
+        }
 
-            // подложку рисуем сначала
-            doc_.Add(start_label_underlayer);
-            doc_.Add(start_label);
+        void MapRenderer::DrawBusLine(svg::Polyline line, const svg::Color& color, svg::ObjectContainer& target) const
+        {
+            line.SetStrokeColor(color).SetFillColor(svg::NoneColor).SetStrokeWidth(settings_.line_width);
+            line.SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-            if (bus_info.start_coords != bus_info.finish_coords)
-            {
-                svg::Text finish_label;
+            target.Add(std::move(line));
+        }
 
-                finish_label.SetPosition(projector_(bus_info.finish_coords)).SetOffset({settings_.bus_label_offset[0], settings_.bus_label_offset[1]});
-                finish_label.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold");
-                finish_label.SetData(static_cast<std::string>(bus_info.name));
+        void MapRenderer::DrawBusLabelAt(std::string_view name, svg::Point position, const svg::Color& color,
+                                         svg::ObjectContainer& target) const
+        {
+            svg::Text label;
 
-                svg::Text finish_label_underlayer = finish_label;
+            label.SetPosition(position).SetOffset({settings_.bus_label_offset[0], settings_.bus_label_offset[1]});
+            label.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold");
+            label.SetData(static_cast<std::string>(name));
 
-                finish_label_underlayer.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color);
-                finish_label_underlayer.SetStrokeWidth(settings_.underlayer_width);
-                finish_label_underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+            svg::Text label_underlayer = label;
 
-                finish_label.SetFillColor(bus_to_color_.at(bus_info.name));
+            label_underlayer.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color);
+            label_underlayer.SetStrokeWidth(settings_.underlayer_width);
+            label_underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-                doc_.Add(finish_label_underlayer);
-                doc_.Add(finish_label);
-                
-            }
+            label.SetFillColor(color);
 
+            // подложку рисуем сначала
+            target.Add(std::move(label_underlayer));
+            target.Add(std::move(label));
         }
 
-        void MapRenderer::DrawStopSymbol(const Core::Stop* stop)
+        void MapRenderer::DrawStopSymbolAt(svg::Point position, svg::ObjectContainer& target) const
         {
             svg::Circle stop_symbol;
-            stop_symbol.SetCenter(projector_(stop->coords)).SetRadius(settings_.stop_radius);
+            stop_symbol.SetCenter(position).SetRadius(settings_.stop_radius);
             stop_symbol.SetFillColor("white");
 
-            doc_.Add(stop_symbol);
+            target.Add(std::move(stop_symbol));
         }
 
-        void MapRenderer::DrawStopLabel(const Core::Stop* stop)
+        void MapRenderer::DrawStopLabelAt(std::string_view name, svg::Point position, svg::ObjectContainer& target) const
         {
             svg::Text stop_label;
 
-            stop_label.SetPosition(projector_(stop->coords)).SetOffset({settings_.stop_label_offset[0], settings_.stop_label_offset[1]});
+            stop_label.SetPosition(position).SetOffset({settings_.stop_label_offset[0], settings_.stop_label_offset[1]});
             stop_label.SetFontSize(settings_.stop_label_font_size).SetFontFamily("Verdana");
-            stop_label.SetData(stop->name);
+            stop_label.SetData(static_cast<std::string>(name));
 
             svg::Text stop_label_underlayer = stop_label;
             stop_label_underlayer.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color);
@@ -191,9 +422,103 @@ namespace TransportInformator
 
             stop_label.SetFillColor("black");
 
-            doc_.Add(stop_label_underlayer);
-            doc_.Add(stop_label);
+            target.Add(std::move(stop_label_underlayer));
+            target.Add(std::move(stop_label));
+        }
+
+        void MapRenderer::ProjectStops(const std::vector<const Core::Stop*>& stops)
+        {
+            uint32_t stop_count = 0;
+            for (const Core::Stop* stop : stops)
+            {
+                stop_count = std::max(stop_count, stop->id + 1);
+            }
+            stop_points_.assign(stop_count, svg::Point{});
+            for (const Core::Stop* stop : stops)
+            {
+                stop_points_[stop->id] = projector_(stop->coords);
+            }
+        }
 
+        svg::Point MapRenderer::GetStopPoint(const Core::Stop* stop) const
+        {
+            // маршруты проходят только через остановки, переданные в ProjectStops
+            assert(stop->id < stop_points_.size());
+            return stop_points_[stop->id];
+        }
+
+        void MapRenderer::PlaceLabels(const std::vector<BusDrawingInfo>& bus_drawing_info,
+                                      const std::vector<const Core::Stop*>& stops_to_draw)
+        {
+            hidden_bus_labels_.clear();
+            hidden_stop_labels_.clear();
+            if (!settings_.label_culling)
+            {
+                return;
+            }
+
+            OccupancyGrid grid{settings_.width, settings_.height,
+                static_cast<double>(std::max(settings_.bus_label_font_size, settings_.stop_label_font_size)) + settings_.underlayer_width};
+            auto try_place = [this, &grid](std::string_view text, const Core::Stop* stop, const std::array<double, 2>& offset,
+                                           size_t font_size, double char_width)
+            {
+                return grid.TryOccupy(GetLabelBox(text, GetStopPoint(stop), offset, font_size, char_width, settings_.underlayer_width));
+            };
+
+            for (const BusDrawingInfo& bus_info : bus_drawing_info)
+            {
+                const Core::Stop* start = bus_info.stops.front();
+                const Core::Stop* finish = bus_info.stops.back();
+                uint8_t hidden = 0;
+                if (!try_place(bus_info.name, start, settings_.bus_label_offset, settings_.bus_label_font_size, LABEL_BOLD_CHAR_WIDTH))
+                {
+                    hidden |= START_LABEL;
+                }
+                if (start->coords != finish->coords
+                    && !try_place(bus_info.name, finish, settings_.bus_label_offset, settings_.bus_label_font_size, LABEL_BOLD_CHAR_WIDTH))
+                {
+                    hidden |= FINISH_LABEL;
+                }
+                if (hidden != 0)
+                {
+                    hidden_bus_labels_[bus_info.name] = hidden;
+                }
+            }
+
+            // число маршрутов через остановку: каждый маршрут считается один раз, сколько бы раз он её ни проходил
+            std::vector<uint32_t> bus_counts(stop_points_.size(), 0);
+            std::vector<size_t> last_bus(stop_points_.size(), bus_drawing_info.size());
+            for (size_t bus = 0; bus < bus_drawing_info.size(); ++bus)
+            {
+                for (const Core::Stop* stop : bus_drawing_info[bus].stops)
+                {
+                    if (last_bus[stop->id] != bus)
+                    {
+                        last_bus[stop->id] = bus;
+                        ++bus_counts[stop->id];
+                    }
+                }
+            }
+
+            std::vector<const Core::Stop*> placement_order = stops_to_draw;
+            std::stable_sort(placement_order.begin(), placement_order.end(), [&bus_counts](const Core::Stop* lhs, const Core::Stop* rhs)
+            {
+                return bus_counts[lhs->id] > bus_counts[rhs->id];
+            });
+
+            hidden_stop_labels_.assign(stop_points_.size(), false);
+            for (const Core::Stop* stop : placement_order)
+            {
+                if (!try_place(stop->name, stop, settings_.stop_label_offset, settings_.stop_label_font_size, LABEL_CHAR_WIDTH))
+                {
+                    hidden_stop_labels_[stop->id] = true;
+                }
+            }
+        }
+
+        bool MapRenderer::IsStopLabelHidden(const Core::Stop* stop) const
+        {
+            return stop->id < hidden_stop_labels_.size() && hidden_stop_labels_[stop->id];
         }
 
         void MapRenderer::MoveCurrentBusColor()
@@ -212,27 +537,276 @@ namespace TransportInformator
         const svg::Document& MapRenderer::RenderMap(const std::vector<BusDrawingInfo>& bus_drawing_info, 
         const std::vector<const Core::Stop*>& stops_to_draw)
         {
+            ProjectStops(stops_to_draw);
+            PlaceLabels(bus_drawing_info, stops_to_draw);
+            doc_.Clear();
+            // на каждый автобус приходится не больше четырёх надписей, на каждую остановку — две
+            doc_.Reserve(stops_to_draw.size(), bus_drawing_info.size(), bus_drawing_info.size() * 4 + stops_to_draw.size() * 2);
+            DrawMap(bus_drawing_info, stops_to_draw, doc_);
+            return doc_;
+        }
+
+        void MapRenderer::RenderMap(const std::vector<BusDrawingInfo>& bus_drawing_info,
+                                    const std::vector<const Core::Stop*>& stops_to_draw, std::ostream& out)
+        {
+            ProjectStops(stops_to_draw);
+            PlaceLabels(bus_drawing_info, stops_to_draw);
+
+            // Карта выводится в четыре прохода: линии маршрутов, названия маршрутов, значки и названия остановок.
+            // Объекты внутри прохода рисуются независимо друг от друга, поэтому проходы режутся на куски
+            auto draw_objects = [&](size_t pass, size_t begin, size_t end, svg::ObjectContainer& target)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    switch (pass)
+                    {
+                    case 0:
+                        DrawBusPath(bus_drawing_info[i], GetBusColor(i), target);
+                        break;
+                    case 1:
+                        DrawBusLabels(bus_drawing_info[i], GetBusColor(i), target);
+                        break;
+                    case 2:
+                        DrawStopSymbolAt(GetStopPoint(stops_to_draw[i]), target);
+                        break;
+                    default:
+                        if (!IsStopLabelHidden(stops_to_draw[i]))
+                        {
+                            DrawStopLabelAt(stops_to_draw[i]->name, GetStopPoint(stops_to_draw[i]), target);
+                        }
+                        break;
+                    }
+                }
+            };
+
+            struct Chunk
+            {
+                size_t pass;
+                size_t begin;
+                size_t end;
+            };
+            const std::array<size_t, 4> pass_sizes{bus_drawing_info.size(), bus_drawing_info.size(),
+                                                   stops_to_draw.size(), stops_to_draw.size()};
+            std::vector<Chunk> chunks;
+            for (size_t pass = 0; pass < pass_sizes.size(); ++pass)
+            {
+                for (size_t begin = 0; begin < pass_sizes[pass]; begin += RENDER_CHUNK_SIZE)
+                {
+                    chunks.push_back({pass, begin, std::min(begin + RENDER_CHUNK_SIZE, pass_sizes[pass])});
+                }
+            }
+
+            svg::RenderDocumentBegin(out);
+
+            const size_t object_count = std::accumulate(pass_sizes.begin(), pass_sizes.end(), size_t{0});
+            const size_t thread_count = object_count < PARALLEL_RENDER_MIN_OBJECTS
+                                        ? 1 : std::min<size_t>(std::thread::hardware_concurrency(), chunks.size());
+            if (thread_count <= 1)
+            {
+                svg::StreamWriter writer{out};
+                for (const Chunk& chunk : chunks)
+                {
+                    draw_objects(chunk.pass, chunk.begin, chunk.end, writer);
+                }
+            }
+            else
+            {
+                // Каждый кусок рисуется в свой буфер с форматом чисел out, буферы выводятся в исходном порядке,
+                // поэтому результат совпадает с последовательной отрисовкой байт в байт
+                std::vector<std::string> rendered_chunks(chunks.size());
+                RunInParallel(chunks.size(), thread_count, [&](size_t chunk_index)
+                {
+                    const Chunk& chunk = chunks[chunk_index];
+                    std::ostringstream chunk_out;
+                    chunk_out.copyfmt(out);
+                    svg::StreamWriter writer{chunk_out};
+                    draw_objects(chunk.pass, chunk.begin, chunk.end, writer);
+                    rendered_chunks[chunk_index] = chunk_out.str();
+                });
+                for (const std::string& rendered_chunk : rendered_chunks)
+                {
+                    out << rendered_chunk;
+                }
+            }
+
+            svg::RenderDocumentEnd(out);
+        }
+
+        const svg::Color& MapRenderer::GetBusColor(size_t bus_index) const
+        {
+            // так же, как MoveCurrentBusColor, цвета палитры идут по кругу
+            return settings_.color_palette[bus_index % settings_.color_palette.size()];
+        }
+
+        void MapRenderer::BuildTileIndex(std::vector<BusDrawingInfo> bus_drawing_info, std::vector<const Core::Stop*> stops_to_draw)
+        {
+            TileData data;
+            data.buses = std::move(bus_drawing_info);
+            data.stops = std::move(stops_to_draw);
+            ProjectStops(data.stops);
+
+            std::vector<ScreenBox> segment_boxes;
+            std::vector<ScreenBox> label_boxes;
+            for (uint32_t bus = 0; bus < data.buses.size(); ++bus)
+            {
+                const BusDrawingInfo& bus_info = data.buses[bus];
+
+                std::vector<const Core::Stop*> path;
+                ForEachBusPathPoint(bus_info, [&path](const Core::Stop* stop) { path.push_back(stop); });
+                for (uint32_t i = 0; i + 1 < path.size(); ++i)
+                {
+                    const svg::Point from = GetStopPoint(path[i]);
+                    const svg::Point to = GetStopPoint(path[i + 1]);
+                    data.segments.push_back({bus, i});
+                    segment_boxes.push_back({{std::min(from.x, to.x), std::min(from.y, to.y)},
+                                             {std::max(from.x, to.x), std::max(from.y, to.y)}});
+                }
+                data.bus_paths.push_back(std::move(path));
+
+                const Core::Stop* start = bus_info.stops.front();
+                const Core::Stop* finish = bus_info.stops.back();
+                data.label_anchors.push_back({bus, start});
+                if (start->coords != finish->coords)
+                {
+                    data.label_anchors.push_back({bus, finish});
+                }
+            }
+            for (const TileData::LabelAnchor& anchor : data.label_anchors)
+            {
+                const svg::Point point = GetStopPoint(anchor.stop);
+                label_boxes.push_back({point, point});
+            }
+
+            std::vector<ScreenBox> stop_boxes;
+            for (const Core::Stop* stop : data.stops)
+            {
+                const svg::Point point = GetStopPoint(stop);
+                stop_boxes.push_back({point, point});
+            }
+
+            data.segments_index = MapSpatialIndex(std::move(segment_boxes), settings_.width, settings_.height);
+            data.labels_index = MapSpatialIndex(std::move(label_boxes), settings_.width, settings_.height);
+            data.stops_index = MapSpatialIndex(std::move(stop_boxes), settings_.width, settings_.height);
+            tile_data_ = std::move(data);
+        }
+
+        bool MapRenderer::HasTileIndex() const
+        {
+            return tile_data_.has_value();
+        }
+
+        void MapRenderer::RenderTile(const MapViewport& viewport, std::ostream& out) const
+        {
+            assert(tile_data_.has_value());
+            const TileData& data = *tile_data_;
+
+            // Участок целиком заполняет изображение, поэтому отступ не нужен
+            const std::array<detail::Coordinates, 2> corners{viewport.min, viewport.max};
+            const SphereProjector tile_projector{corners.begin(), corners.end(),
+                viewport.width.value_or(settings_.width), viewport.height.value_or(settings_.height), 0.};
+
+            // В координатах полной карты север сверху, поэтому северо-западный угол даёт минимум
+            const ScreenBox area{projector_({viewport.max.lat, viewport.min.lng}),
+                                 projector_({viewport.min.lat, viewport.max.lng})};
+
+            svg::RenderDocumentBegin(out);
+            svg::StreamWriter writer{out};
+
+            // Подряд идущие отрезки одного маршрута выводятся одной ломаной
+            const std::vector<uint32_t> segment_ids = data.segments_index.Find(area);
+            for (size_t i = 0; i < segment_ids.size();)
+            {
+                const TileData::PathSegment& first = data.segments[segment_ids[i]];
+                size_t last = i;
+                while (last + 1 < segment_ids.size()
+                       && data.segments[segment_ids[last + 1]].bus == first.bus
+                       && data.segments[segment_ids[last + 1]].index == data.segments[segment_ids[last]].index + 1)
+                {
+                    ++last;
+                }
+
+                const std::vector<const Core::Stop*>& path = data.bus_paths[first.bus];
+                svg::Polyline line;
+                for (uint32_t point = first.index; point <= data.segments[segment_ids[last]].index + 1; ++point)
+                {
+                    line.AddPoint(tile_projector(path[point]->coords));
+                }
+                DrawBusLine(std::move(line), GetBusColor(first.bus), writer);
+                i = last + 1;
+            }
+
+            for (const uint32_t id : data.labels_index.Find(area))
+            {
+                const TileData::LabelAnchor& anchor = data.label_anchors[id];
+                DrawBusLabelAt(data.buses[anchor.bus].name, tile_projector(anchor.stop->coords), GetBusColor(anchor.bus), writer);
+            }
+
+            const std::vector<uint32_t> stop_ids = data.stops_index.Find(area);
+            for (const uint32_t id : stop_ids)
+            {
+                DrawStopSymbolAt(tile_projector(data.stops[id]->coords), writer);
+            }
+            for (const uint32_t id : stop_ids)
+            {
+                DrawStopLabelAt(data.stops[id]->name, tile_projector(data.stops[id]->coords), writer);
+            }
+
+            svg::RenderDocumentEnd(out);
+        }
+
+        void MapRenderer::RenderRoute(const std::vector<RouteLegDrawingInfo>& legs,
+                                      const std::vector<const Core::Stop*>& stops_to_draw, std::ostream& out) const
+        {
+            svg::RenderDocumentBegin(out);
+            svg::StreamWriter writer{out};
+
+            for (const RouteLegDrawingInfo& leg : legs)
+            {
+                svg::Polyline line;
+                for (const Core::Stop* stop : leg.stops)
+                {
+                    line.AddPoint(projector_(stop->coords));
+                }
+                DrawBusLine(std::move(line), GetBusColor(leg.bus_index), writer);
+            }
+            for (const Core::Stop* stop : stops_to_draw)
+            {
+                DrawStopSymbolAt(projector_(stop->coords), writer);
+            }
+            for (const Core::Stop* stop : stops_to_draw)
+            {
+                DrawStopLabelAt(stop->name, projector_(stop->coords), writer);
+            }
+
+            svg::RenderDocumentEnd(out);
+        }
+
+        void MapRenderer::DrawMap(const std::vector<BusDrawingInfo>& bus_drawing_info,
+                                  const std::vector<const Core::Stop*>& stops_to_draw, svg::ObjectContainer& target)
+        {
+            // каждая отрисовка начинается с первого цвета палитры
+            bus_to_color_.clear();
+            bus_color_it = settings_.color_palette.begin();
+
             for (const auto& bus_info : bus_drawing_info)
             {
-                DrawBus(bus_info);
+                DrawBus(bus_info, target);
             }
 
             for (const auto& bus_info : bus_drawing_info)
             {
-                DrawBusLabel(bus_info);
+                DrawBusLabel(bus_info, target);
             }
 
             for (const auto stop_ptr : stops_to_draw)
             {
-                DrawStopSymbol(stop_ptr);
+                DrawStopSymbol(stop_ptr, target);
             }
 
             for (const auto& stop_ptr : stops_to_draw)
             {
-                DrawStopLabel(stop_ptr);
+                DrawStopLabel(stop_ptr, target);
             }
-
-            return doc_;
         }
 
     } // namespace TransportInformator::Render
@@ -3,6 +3,9 @@
 #include "geo.h"
 #include "svg.h"
 #include "domain.h"
+#include "map_spatial_index.h"
+#include <array>
+#include <optional>
 #include <variant>
 #include <unordered_map>
 
@@ -38,17 +41,47 @@ struct RenderSettings
     svg::Color underlayer_color;
     double underlayer_width;
     std::vector<svg::Color> color_palette;
+    // Допустимое отклонение упрощённой линии маршрута в пикселях; 0 — линии выводятся без упрощения.
+    // При упрощении некольцевой маршрут рисуется одним проходом до конечной: обратный путь совпадает с ним.
+    double simplification_tolerance = 0;
+    // Не выводить надписи, которые перекрыли бы уже выведенные. Первыми расставляются названия маршрутов,
+    // затем названия остановок: сначала остановки, через которые проходит больше маршрутов.
+    bool label_culling = false;
 };
 
+// Остановки маршрута не копируются: они живут в справочнике, из которого взят маршрут
 struct BusDrawingInfo
 {
     std::string_view name;
-    std::vector<detail::Coordinates> stops_coords;
+    detail::Span<const Core::Stop*> stops;
     bool is_roundtrip;
-    detail::Coordinates start_coords;
-    detail::Coordinates finish_coords;
 };
 
+// Участок поездки на одном автобусе: остановки от посадки до высадки.
+// bus_index — номер маршрута среди маршрутов полной карты, по нему выбирается цвет линии.
+struct RouteLegDrawingInfo
+{
+    size_t bus_index;
+    std::vector<const Core::Stop*> stops;
+};
+
+// Участок карты для отрисовки фрагмента: прямоугольник широт и долгот и размер изображения.
+// Если размер не задан, берётся из RenderSettings.
+struct MapViewport
+{
+    detail::Coordinates min;
+    detail::Coordinates max;
+    std::optional<double> width;
+    std::optional<double> height;
+};
+
+// Упрощает ломаную алгоритмом Дугласа-Пекера: оставшиеся вершины отклоняются
+// от исходной линии не больше чем на tolerance. Первая и последняя вершины сохраняются.
+std::vector<svg::Point> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance);
+
+// Участок карты, покрываемый тайлом x/y уровня zoom в принятой у веб-карт сетке
+MapViewport GetTileViewport(int zoom, int x, int y);
+
 class SphereProjector {
 public:
     // points_begin и points_end задают начало и конец интервала элементов geo::Coordinates
@@ -69,26 +102,97 @@ class MapRenderer
 {
     public:
     MapRenderer(const RenderSettings& settings, const std::vector<detail::Coordinates>& all_coords);
-    void DrawBus(const BusDrawingInfo& bus_info);
-    void DrawBusLabel(const BusDrawingInfo& bus_info);
-    void DrawStopSymbol(const Core::Stop* stop);
-    void DrawStopLabel(const Core::Stop* stop);
+    void DrawBus(const BusDrawingInfo& bus_info, svg::ObjectContainer& target);
+    void DrawBusLabel(const BusDrawingInfo& bus_info, svg::ObjectContainer& target);
+    void DrawStopSymbol(const Core::Stop* stop, svg::ObjectContainer& target);
+    void DrawStopLabel(const Core::Stop* stop, svg::ObjectContainer& target);
     const svg::Document& RenderMap(const std::vector<BusDrawingInfo>& bus_drawing_info, 
     const std::vector<const Core::Stop*>& stops_to_draw );
 
+    // Выводит карту в поток, не собирая svg::Document. На многоядерной машине
+    // части карты рисуются параллельно; результат не зависит от числа потоков.
+    void RenderMap(const std::vector<BusDrawingInfo>& bus_drawing_info,
+                   const std::vector<const Core::Stop*>& stops_to_draw, std::ostream& out);
+
+    // Готовит индекс для отрисовки фрагментов карты; объекты те же, что передаются в RenderMap
+    void BuildTileIndex(std::vector<BusDrawingInfo> bus_drawing_info, std::vector<const Core::Stop*> stops_to_draw);
+    bool HasTileIndex() const;
+
+    // Выводит фрагмент карты: попавшие в участок отрезки маршрутов, а также названия маршрутов и остановки,
+    // точки привязки которых лежат в участке. Цвета маршрутов совпадают с цветами на полной карте.
+    void RenderTile(const MapViewport& viewport, std::ostream& out) const;
+
+    // Выводит только поездку: линии её участков цветами их маршрутов, а затем значки и названия
+    // остановок stops_to_draw. Координаты совпадают с полной картой, поэтому изображение можно наложить на неё.
+    void RenderRoute(const std::vector<RouteLegDrawingInfo>& legs, const std::vector<const Core::Stop*>& stops_to_draw,
+                     std::ostream& out) const;
+
     const svg::Document& GetDocument() const;
 
     private:
+    // Объекты карты, разложенные по пространственным индексам в координатах полной карты
+    struct TileData
+    {
+        struct PathSegment
+        {
+            uint32_t bus;
+            uint32_t index;
+        };
+
+        struct LabelAnchor
+        {
+            uint32_t bus;
+            const Core::Stop* stop;
+        };
+
+        std::vector<BusDrawingInfo> buses;
+        // остановки линий маршрутов в порядке отрисовки
+        std::vector<std::vector<const Core::Stop*>> bus_paths;
+        std::vector<const Core::Stop*> stops;
+        std::vector<PathSegment> segments;
+        std::vector<LabelAnchor> label_anchors;
+
+        MapSpatialIndex segments_index;
+        MapSpatialIndex labels_index;
+        MapSpatialIndex stops_index;
+    };
+
+    // Проецирует каждую остановку один раз; проходы отрисовки берут готовые точки по номеру остановки
+    void ProjectStops(const std::vector<const Core::Stop*>& stops);
+    svg::Point GetStopPoint(const Core::Stop* stop) const;
+
+    // Решает, какие надписи полной карты не выводить, если в настройках включён их отсев
+    void PlaceLabels(const std::vector<BusDrawingInfo>& bus_drawing_info, const std::vector<const Core::Stop*>& stops_to_draw);
+    bool IsStopLabelHidden(const Core::Stop* stop) const;
+
     void MoveCurrentBusColor();
 
+    const svg::Color& GetBusColor(size_t bus_index) const;
+
+    void DrawBusPath(const BusDrawingInfo& bus_info, const svg::Color& color, svg::ObjectContainer& target) const;
+    void DrawBusLabels(const BusDrawingInfo& bus_info, const svg::Color& color, svg::ObjectContainer& target) const;
+    void DrawBusLine(svg::Polyline line, const svg::Color& color, svg::ObjectContainer& target) const;
+    void DrawBusLabelAt(std::string_view name, svg::Point position, const svg::Color& color, svg::ObjectContainer& target) const;
+    void DrawStopSymbolAt(svg::Point position, svg::ObjectContainer& target) const;
+    void DrawStopLabelAt(std::string_view name, svg::Point position, svg::ObjectContainer& target) const;
+    void DrawMap(const std::vector<BusDrawingInfo>& bus_drawing_info,
+                 const std::vector<const Core::Stop*>& stops_to_draw, svg::ObjectContainer& target);
+
     std::unordered_map<std::string_view, svg::Color> bus_to_color_;
 
     RenderSettings settings_;
     std::vector<svg::Color>::const_iterator bus_color_it;
     SphereProjector projector_;
+    // точки остановок на полной карте, индекс — Core::Stop::id
+    std::vector<svg::Point> stop_points_;
+    // надписи, убранные при расстановке: у маршрута бит 0 — начальная остановка, бит 1 — конечная
+    std::unordered_map<std::string_view, uint8_t> hidden_bus_labels_;
+    // индекс — Core::Stop::id
+    std::vector<bool> hidden_stop_labels_;
 
     svg::Document doc_;
-    
+
+    std::optional<TileData> tile_data_;
 };
 
 } // namespace TransportInformator::Render
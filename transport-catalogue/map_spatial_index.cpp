@@ -0,0 +1,181 @@
+#include "map_spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TransportInformator
+{
+
+namespace Render
+{
+
+namespace
+{
+    // В среднем столько объектов приходится на одну ячейку самой мелкой сетки
+    const size_t ITEMS_PER_CELL = 4;
+    const size_t MAX_GRID_SIDE = 1024;
+
+    size_t ToCell(double value, double cell_size, size_t cell_count)
+    {
+        if (!(value > 0))
+        {
+            return 0;
+        }
+        return std::min(static_cast<size_t>(value / cell_size), cell_count - 1);
+    }
+}
+
+bool ScreenBox::Intersects(const ScreenBox& other) const
+{
+    return min.x <= other.max.x && other.min.x <= max.x
+        && min.y <= other.max.y && other.min.y <= max.y;
+}
+
+MapSpatialIndex::CellRange MapSpatialIndex::Grid::GetCellRange(const ScreenBox& box) const
+{
+    return {ToCell(box.min.x, cell_width, side), ToCell(box.max.x, cell_width, side),
+            ToCell(box.min.y, cell_height, side), ToCell(box.max.y, cell_height, side)};
+}
+
+MapSpatialIndex::MapSpatialIndex(std::vector<ScreenBox> boxes, double width, double height) : boxes_{std::move(boxes)}
+{
+    const size_t finest_side = static_cast<size_t>(std::sqrt(static_cast<double>(boxes_.size() / ITEMS_PER_CELL)));
+    for (size_t side = std::clamp<size_t>(finest_side, 1, MAX_GRID_SIDE); ; side = (side + 1) / 2)
+    {
+        Grid grid;
+        grid.side = side;
+        grid.cell_width = width > 0 ? width / side : 1;
+        grid.cell_height = height > 0 ? height / side : 1;
+        grid.cell_begin.assign(side * side + 1, 0);
+        grids_.push_back(std::move(grid));
+        if (side == 1)
+        {
+            break;
+        }
+    }
+
+    // Выбираем сетку для каждого объекта и считаем объекты в каждой ячейке
+    std::vector<uint8_t> item_grid(boxes_.size());
+    for (size_t id = 0; id < boxes_.size(); ++id)
+    {
+        uint8_t level = 0;
+        CellRange range = grids_[level].GetCellRange(boxes_[id]);
+        while (range.column_to - range.column_from > 1 || range.row_to - range.row_from > 1)
+        {
+            range = grids_[++level].GetCellRange(boxes_[id]);
+        }
+        item_grid[id] = level;
+
+        Grid& grid = grids_[level];
+        for (size_t row = range.row_from; row <= range.row_to; ++row)
+        {
+            for (size_t column = range.column_from; column <= range.column_to; ++column)
+            {
+                ++grid.cell_begin[row * grid.side + column + 1];
+            }
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> cell_filled;
+    for (Grid& grid : grids_)
+    {
+        for (size_t i = 1; i < grid.cell_begin.size(); ++i)
+        {
+            grid.cell_begin[i] += grid.cell_begin[i - 1];
+        }
+        grid.cell_items.resize(grid.cell_begin.back());
+        cell_filled.emplace_back(grid.cell_begin.begin(), std::prev(grid.cell_begin.end()));
+    }
+
+    for (uint32_t id = 0; id < boxes_.size(); ++id)
+    {
+        Grid& grid = grids_[item_grid[id]];
+        const CellRange range = grid.GetCellRange(boxes_[id]);
+        for (size_t row = range.row_from; row <= range.row_to; ++row)
+        {
+            for (size_t column = range.column_from; column <= range.column_to; ++column)
+            {
+                grid.cell_items[cell_filled[item_grid[id]][row * grid.side + column]++] = id;
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> MapSpatialIndex::Find(const ScreenBox& area) const
+{
+    std::vector<uint32_t> result;
+    for (const Grid& grid : grids_)
+    {
+        if (grid.cell_items.empty())
+        {
+            continue;
+        }
+        const CellRange range = grid.GetCellRange(area);
+        for (size_t row = range.row_from; row <= range.row_to; ++row)
+        {
+            for (size_t column = range.column_from; column <= range.column_to; ++column)
+            {
+                const size_t cell = row * grid.side + column;
+                for (size_t i = grid.cell_begin[cell]; i < grid.cell_begin[cell + 1]; ++i)
+                {
+                    if (boxes_[grid.cell_items[i]].Intersects(area))
+                    {
+                        result.push_back(grid.cell_items[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    // объект, задевающий несколько ячеек, найден в каждой из них
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+OccupancyGrid::OccupancyGrid(double width, double height, double cell_size)
+{
+    // слишком мелкие ячейки укрупняем, чтобы сетка оставалась не больше MAX_GRID_SIDE x MAX_GRID_SIDE
+    cell_size_ = std::max({cell_size, width / MAX_GRID_SIDE, height / MAX_GRID_SIDE, 1.});
+    columns_ = std::max<size_t>(1, static_cast<size_t>(std::ceil(width / cell_size_)));
+    rows_ = std::max<size_t>(1, static_cast<size_t>(std::ceil(height / cell_size_)));
+    cells_.resize(columns_ * rows_);
+}
+
+bool OccupancyGrid::TryOccupy(const ScreenBox& box)
+{
+    // прямоугольники за краем изображения попадают в крайние ячейки
+    const size_t column_from = ToCell(box.min.x, cell_size_, columns_);
+    const size_t column_to = ToCell(box.max.x, cell_size_, columns_);
+    const size_t row_from = ToCell(box.min.y, cell_size_, rows_);
+    const size_t row_to = ToCell(box.max.y, cell_size_, rows_);
+
+    for (size_t row = row_from; row <= row_to; ++row)
+    {
+        for (size_t column = column_from; column <= column_to; ++column)
+        {
+            for (const uint32_t id : cells_[row * columns_ + column])
+            {
+                if (boxes_[id].Intersects(box))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    const uint32_t id = static_cast<uint32_t>(boxes_.size());
+    boxes_.push_back(box);
+    for (size_t row = row_from; row <= row_to; ++row)
+    {
+        for (size_t column = column_from; column <= column_to; ++column)
+        {
+            cells_[row * columns_ + column].push_back(id);
+        }
+    }
+    return true;
+}
+
+} // namespace TransportInformator::Render
+
+} // namespace TransportInformator
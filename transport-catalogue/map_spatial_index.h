@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "svg.h"
+
+namespace TransportInformator
+{
+
+namespace Render
+{
+
+// Прямоугольник в координатах изображения
+struct ScreenBox
+{
+    svg::Point min;
+    svg::Point max;
+
+    bool Intersects(const ScreenBox& other) const;
+};
+
+// Иерархия равномерных сеток над изображением карты: каждая следующая сетка вдвое крупнее.
+// Объект записывается в самую мелкую сетку, где его ограничивающий прямоугольник задевает
+// не больше 2x2 ячеек, поэтому длинные отрезки не размножаются по тысячам ячеек.
+// Строится один раз, дальше только читается.
+class MapSpatialIndex
+{
+    public:
+    MapSpatialIndex() = default;
+    MapSpatialIndex(std::vector<ScreenBox> boxes, double width, double height);
+
+    // Номера объектов, прямоугольники которых пересекаются с area, по возрастанию
+    std::vector<uint32_t> Find(const ScreenBox& area) const;
+
+    private:
+    struct CellRange
+    {
+        size_t column_from;
+        size_t column_to;
+        size_t row_from;
+        size_t row_to;
+    };
+
+    struct Grid
+    {
+        size_t side = 1;
+        double cell_width = 1;
+        double cell_height = 1;
+        // объекты ячейки i лежат в cell_items с cell_begin[i] по cell_begin[i + 1]
+        std::vector<uint32_t> cell_begin;
+        std::vector<uint32_t> cell_items;
+
+        CellRange GetCellRange(const ScreenBox& box) const;
+    };
+
+    std::vector<ScreenBox> boxes_;
+    // от самой мелкой сетки к сетке из одной ячейки
+    std::vector<Grid> grids_;
+};
+
+// Равномерная сетка над изображением, в которую по одному добавляются непересекающиеся прямоугольники.
+// Если ячейка сравнима с размером прямоугольника, каждая проверка затрагивает лишь несколько ячеек.
+class OccupancyGrid
+{
+    public:
+    OccupancyGrid(double width, double height, double cell_size);
+
+    // Занимает box и возвращает true, если он не пересекается с занятыми ранее; иначе ничего не меняет
+    bool TryOccupy(const ScreenBox& box);
+
+    private:
+    size_t columns_;
+    size_t rows_;
+    double cell_size_;
+    std::vector<ScreenBox> boxes_;
+    // номера занятых прямоугольников, задевающих ячейку
+    std::vector<std::vector<uint32_t>> cells_;
+};
+
+} // namespace TransportInformator::Render
+
+} // namespace TransportInformator
@@ -0,0 +1,78 @@
+#include "number_format.h"
+
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <ios>
+
+namespace TransportInformator
+{
+
+namespace detail
+{
+
+namespace
+{
+    // самое длинное число в формате %g: знак, 17 значащих цифр, точка и порядок "e-308"
+    using NumberBuffer = std::array<char, MAX_NUMBER_LENGTH>;
+    constexpr std::streamsize MAX_PRECISION = 17;
+
+    // Флаги, с которыми operator<< выводит число не так, как to_chars
+    const std::ios_base::fmtflags NON_DEFAULT_FLAGS = std::ios_base::floatfield
+        | (std::ios_base::basefield & ~std::ios_base::dec) | std::ios_base::showpoint | std::ios_base::showpos
+        | std::ios_base::showbase | std::ios_base::uppercase;
+
+    bool HasDefaultFormat(const std::ostream& out)
+    {
+        return out.width() == 0 && (out.flags() & NON_DEFAULT_FLAGS) == 0;
+    }
+}
+
+bool HasPlainNumberFormat(const std::ostream& out)
+{
+    return HasDefaultFormat(out) && out.precision() >= 0 && out.precision() <= MAX_PRECISION;
+}
+
+char* FormatNumber(char* first, double value, int precision)
+{
+    const auto [end, error] = std::to_chars(first, first + MAX_NUMBER_LENGTH, value, std::chars_format::general, precision);
+    assert(error == std::errc{});
+    return end;
+}
+
+char* FormatNumber(char* first, int value)
+{
+    const auto [end, error] = std::to_chars(first, first + MAX_NUMBER_LENGTH, value);
+    assert(error == std::errc{});
+    return end;
+}
+
+void WriteNumber(std::ostream& out, double value)
+{
+    if (!HasPlainNumberFormat(out))
+    {
+        out << value;
+        return;
+    }
+
+    NumberBuffer buffer;
+    const char* end = FormatNumber(buffer.data(), value, static_cast<int>(out.precision()));
+    out.write(buffer.data(), end - buffer.data());
+}
+
+void WriteNumber(std::ostream& out, int value)
+{
+    if (!HasDefaultFormat(out))
+    {
+        out << value;
+        return;
+    }
+
+    NumberBuffer buffer;
+    const char* end = FormatNumber(buffer.data(), value);
+    out.write(buffer.data(), end - buffer.data());
+}
+
+} // namespace TransportInformator::detail
+
+} // namespace TransportInformator
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+namespace TransportInformator
+{
+
+namespace detail
+{
+
+// Выводят число в поток так же, как operator<<, но без обращения к локали и без промежуточных строк.
+// Число форматируется std::to_chars в буфер на стеке: для double — как %g с точностью потока.
+// Если у потока заданы ширина или флаги формата, вывод передаётся обычному operator<<.
+void WriteNumber(std::ostream& out, double value);
+void WriteNumber(std::ostream& out, int value);
+
+// Самое длинное число, которое записывает FormatNumber
+constexpr size_t MAX_NUMBER_LENGTH = 32;
+
+// Можно ли вместо вывода чисел в поток out записывать их функциями FormatNumber с точностью потока:
+// у потока нет ширины и флагов формата, а точность не больше 17
+bool HasPlainNumberFormat(const std::ostream& out);
+
+// Записывают число в буфер длиной MAX_NUMBER_LENGTH, начинающийся с first, и возвращают конец записи
+char* FormatNumber(char* first, double value, int precision);
+char* FormatNumber(char* first, int value);
+
+} // namespace TransportInformator::detail
+
+} // namespace TransportInformator
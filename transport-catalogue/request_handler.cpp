@@ -11,6 +11,10 @@
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
+#include <limits>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
 
 
 
@@ -20,9 +24,44 @@ namespace TransportInformator
 
     namespace ReqHandler
     {
+        namespace
+        {
+            // Остановки, которые автобус проезжает за span_count перегонов от from до to.
+            // Рёбра графа маршрутизации строятся отдельно для каждого направления некольцевого маршрута,
+            // поэтому и участок ищется в одном направлении
+            template <typename StopIt>
+            std::optional<std::vector<const Core::Stop*>> FindLegStops(StopIt begin, StopIt end, const Core::Stop* from,
+                                                                       const Core::Stop* to, int span_count)
+            {
+                for (auto it = begin; std::distance(it, end) > span_count; ++it)
+                {
+                    const auto leg_end = std::next(it, span_count);
+                    if (*it == from && *leg_end == to)
+                    {
+                        return std::vector<const Core::Stop*>(it, std::next(leg_end));
+                    }
+                }
+                return std::nullopt;
+            }
+
+            std::vector<const Core::Stop*> FindLegStops(const Core::Bus& bus, const Core::Stop* from,
+                                                        const Core::Stop* to, int span_count)
+            {
+                auto stops = FindLegStops(bus.stops.begin(), bus.stops.end(), from, to, span_count);
+                if (!stops.has_value() && !bus.is_roundtrip)
+                {
+                    stops = FindLegStops(bus.stops.rbegin(), bus.stops.rend(), from, to, span_count);
+                }
+                if (!stops.has_value())
+                {
+                    throw std::logic_error("Route leg doesn't match stops of bus " + std::string(bus.name));
+                }
+                return std::move(*stops);
+            }
+        }
 
         // MapRenderer понадобится в следующей части итогового проекта
-        RequestHandler::RequestHandler(Core::TransportCatalogue& db, Render::MapRenderer& renderer, Router::TransportRouter& router)
+        RequestHandler::RequestHandler(const Core::TransportCatalogue& db, Render::MapRenderer& renderer, Router::TransportRouter& router)
         : db_{db}, renderer_{renderer}, router_{router}{}
 
         // Возвращает информацию о маршруте (запрос Bus)
@@ -31,6 +70,12 @@ namespace TransportInformator
             return db_.GetBusInfo(bus_name);
         }
 
+        // Возвращает информацию об остановке (запрос Stop)
+        std::optional<Core::StopInfo> RequestHandler::GetStopStat(const std::string_view &stop_name) const
+        {
+            return db_.GetStopInfo(stop_name);
+        }
+
         // Возвращает маршруты, проходящие через остановку
         const std::set<std::string_view> RequestHandler::GetBusesByStop(const std::string_view &stop_name) const
         {
@@ -40,28 +85,141 @@ namespace TransportInformator
         // Этот метод будет нужен в следующей части итогового проекта
         const svg::Document& RequestHandler::RenderMap()
         {
-            
+            const auto [bus_draw_info, stop_draw_info] = CollectMapObjects();
+            return renderer_.RenderMap(bus_draw_info, stop_draw_info);   
+        }
+
+        void RequestHandler::RenderMapSvg(std::ostream& out)
+        {
+            const auto [bus_draw_info, stop_draw_info] = CollectMapObjects();
+            renderer_.RenderMap(bus_draw_info, stop_draw_info, out);
+        }
+
+        void RequestHandler::PrepareMapIndices()
+        {
+            auto [bus_draw_info, stop_draw_info] = CollectMapObjects();
+            // полная карта рисует непустые маршруты в порядке названий
+            bus_drawing_indices_.clear();
+            bus_drawing_indices_.reserve(bus_draw_info.size());
+            for (const Render::BusDrawingInfo& bus_info : bus_draw_info)
+            {
+                bus_drawing_indices_.emplace(bus_info.name, bus_drawing_indices_.size());
+            }
+            renderer_.BuildTileIndex(std::move(bus_draw_info), std::move(stop_draw_info));
+            map_indices_prepared_ = true;
+        }
+
+        void RequestHandler::RenderMapTile(const Render::MapViewport& viewport, std::ostream& out) const
+        {
+            if (!map_indices_prepared_)
+            {
+                throw std::logic_error("Map indices are not prepared");
+            }
+            renderer_.RenderTile(viewport, out);
+        }
+
+        void RequestHandler::RenderRouteMap(const Router::Route& route, std::string_view to, std::ostream& out) const
+        {
+            if (!map_indices_prepared_)
+            {
+                throw std::logic_error("Map indices are not prepared");
+            }
+
+            std::vector<Render::RouteLegDrawingInfo> legs;
+            // остановки, где пассажир садится на автобус, и конечная остановка поездки
+            std::vector<const Core::Stop*> stops_to_draw;
+
+            const auto& details = route.route_details;
+            for (size_t i = 0; i < details.size(); ++i)
+            {
+                if (const auto* wait = std::get_if<Router::Route::RouteElementWait>(&details[i]))
+                {
+                    stops_to_draw.push_back(db_.FindStop(wait->stop_name));
+                    continue;
+                }
+
+                // поездке на автобусе всегда предшествует ожидание на остановке посадки,
+                // а высадка происходит там, где начинается следующее ожидание, или в конце поездки
+                const auto& ride = std::get<Router::Route::RouteElementBus>(details[i]);
+                assert(!stops_to_draw.empty());
+                const Core::Stop* from_stop = stops_to_draw.back();
+                const Core::Stop* to_stop = i + 1 < details.size()
+                    ? db_.FindStop(std::get<Router::Route::RouteElementWait>(details[i + 1]).stop_name)
+                    : db_.FindStop(to);
+
+                legs.push_back({GetBusDrawingIndex(ride.bus),
+                                FindLegStops(*db_.FindBus(ride.bus), from_stop, to_stop, ride.span_count)});
+            }
+            stops_to_draw.push_back(db_.FindStop(to));
+
+            renderer_.RenderRoute(legs, stops_to_draw, out);
+        }
+
+        size_t RequestHandler::GetBusDrawingIndex(std::string_view bus_name) const
+        {
+            return bus_drawing_indices_.at(bus_name);
+        }
+
+        std::string RequestHandler::RenderMapSvg()
+        {
+            std::ostringstream out;
+            RenderMapSvg(out);
+            return out.str();
+        }
+
+        std::pair<std::vector<Render::BusDrawingInfo>, std::vector<const Core::Stop*>> RequestHandler::CollectMapObjects() const
+        {
             std::vector<Render::BusDrawingInfo> bus_draw_info;
 
             const auto buses_to_draw = db_.GetAllNonEmptyBuses();
+            bus_draw_info.reserve(buses_to_draw.size());
             for (const auto& bus_name : buses_to_draw)
             {
                 const Core::Bus* bus_ptr = db_.FindBus(bus_name);
-                const auto start = bus_ptr->stops.front();
-                const auto finish = bus_ptr->stops.back();
-                bus_draw_info.push_back({bus_ptr->name, db_.GetBusStopCoordsForBus(bus_name), bus_ptr->is_roundtrip, start->coords, finish->coords});
+                bus_draw_info.push_back({bus_ptr->name, bus_ptr->stops, bus_ptr->is_roundtrip});
             }
 
             std::vector<const Core::Stop*> stop_draw_info;
 
             const auto stops_to_draw = db_.GetAllNonEmptyStops();
+            stop_draw_info.reserve(stops_to_draw.size());
 
             for (const auto& stop_name : stops_to_draw)
             {
                 stop_draw_info.push_back({db_.FindStop(stop_name)});
             }
 
-            return renderer_.RenderMap(bus_draw_info, stop_draw_info);   
+            return {std::move(bus_draw_info), std::move(stop_draw_info)};
+        }
+
+        void RequestHandler::SetRenderedMap(std::string map_svg)
+        {
+            rendered_map_ = std::make_shared<const std::string>(std::move(map_svg));
+        }
+
+        bool RequestHandler::HasRenderedMap() const
+        {
+            return rendered_map_ != nullptr;
+        }
+
+        std::shared_ptr<const std::string> RequestHandler::GetRenderedMap() const
+        {
+            assert(rendered_map_ != nullptr);
+            return rendered_map_;
+        }
+
+        void RequestHandler::SetReloadTrigger(std::function<BaseGenerationInfo()> trigger)
+        {
+            reload_trigger_ = std::move(trigger);
+        }
+
+        std::optional<BaseGenerationInfo> RequestHandler::Reload() const
+        {
+            if (!reload_trigger_)
+            {
+                return std::nullopt;
+            }
+            return reload_trigger_();
         }
 
         std::optional<Router::Route> RequestHandler::BuildRoute(std::string_view from, std::string_view to) const
@@ -69,6 +227,16 @@ namespace TransportInformator
             return router_.BuildRoute(from, to);
         }
 
+        std::vector<Core::NearbyStop> RequestHandler::GetNearestStops(detail::Coordinates center,
+                                                                      std::optional<double> radius, std::optional<size_t> count) const
+        {
+            if (radius.has_value())
+            {
+                return db_.FindStopsInRadius(center, *radius, count.value_or(std::numeric_limits<size_t>::max()));
+            }
+            return db_.FindNearestStops(center, count.value_or(0));
+        }
+
     }
 
 
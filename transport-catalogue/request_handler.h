@@ -21,38 +21,94 @@
 #include "transport_router.h"
 #include "serialization.h"
 
+#include <functional>
+#include <utility>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace TransportInformator
 {
 
 namespace ReqHandler
 {
+    // Состояние загруженной базы для управляющего запроса Reload
+    struct BaseGenerationInfo
+    {
+        size_t generation;
+        double load_time_ms;
+        bool reload_started;
+    };
+
     class RequestHandler {
         public:
             // MapRenderer понадобится в следующей части итогового проекта
-            RequestHandler(Core::TransportCatalogue& db, Render::MapRenderer& renderer, Router::TransportRouter& router);
+            RequestHandler(const Core::TransportCatalogue& db, Render::MapRenderer& renderer, Router::TransportRouter& router);
 
             // Возвращает информацию о маршруте (запрос Bus)
             std::optional<Core::BusInfo> GetBusStat(const std::string_view& bus_name) const;
 
+            // Возвращает информацию об остановке (запрос Stop)
+            std::optional<Core::StopInfo> GetStopStat(const std::string_view& stop_name) const;
+
             // Возвращает маршруты, проходящие через остановку
             const std::set<std::string_view> GetBusesByStop(const std::string_view& stop_name) const;
 
             // Этот метод будет нужен в следующей части итогового проекта
             const svg::Document& RenderMap();
 
+            // Отрисовывает карту и возвращает текст SVG-документа
+            std::string RenderMapSvg();
+            // Выводит SVG-документ в поток по мере отрисовки, не храня карту целиком
+            void RenderMapSvg(std::ostream& out);
+
+            // Готовит индексы для запросов к фрагментам карты и к поездкам на карте. Вызывается при загрузке
+            // базы, пока её не видят другие потоки: дальше запросы только читают состояние обработчика и визуализатора
+            void PrepareMapIndices();
+
+            // Выводит SVG-документ с участком карты; нужен индекс из PrepareMapIndices
+            void RenderMapTile(const Render::MapViewport& viewport, std::ostream& out) const;
+
+            // Выводит SVG-документ только с поездкой route, которая заканчивается на остановке to.
+            // Линии и остановки лежат там же, где на полной карте; нужны номера маршрутов из PrepareMapIndices
+            void RenderRouteMap(const Router::Route& route, std::string_view to, std::ostream& out) const;
+
+            // Готова ли карта, отрисованная заранее
+            bool HasRenderedMap() const;
+
+            // Готовая карта, отрисованная один раз при загрузке базы; запросы Map берут её отсюда
+            void SetRenderedMap(std::string map_svg);
+            std::shared_ptr<const std::string> GetRenderedMap() const;
+
+            // Запуск перезагрузки базы; без заданного обработчика перезагрузка недоступна
+            void SetReloadTrigger(std::function<BaseGenerationInfo()> trigger);
+            std::optional<BaseGenerationInfo> Reload() const;
+
             std::optional<Router::Route> BuildRoute(std::string_view from, std::string_view to) const;
 
+            // Возвращает остановки рядом с точкой: в пределах radius метров и/или не более count ближайших
+            std::vector<Core::NearbyStop> GetNearestStops(detail::Coordinates center,
+                                                          std::optional<double> radius, std::optional<size_t> count) const;
+
 
         private:
+            std::pair<std::vector<Render::BusDrawingInfo>, std::vector<const Core::Stop*>> CollectMapObjects() const;
+            // Номер маршрута в порядке отрисовки полной карты
+            size_t GetBusDrawingIndex(std::string_view bus_name) const;
+
             // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
 
-            Core::TransportCatalogue& db_;
+            const Core::TransportCatalogue& db_;
             Render::MapRenderer& renderer_;
             Router::TransportRouter& router_;
+
+            std::unordered_map<std::string_view, size_t> bus_drawing_indices_;
+            bool map_indices_prepared_ = false;
+            std::shared_ptr<const std::string> rendered_map_;
+            std::function<BaseGenerationInfo()> reload_trigger_;
     };
 
 
@@ -2,6 +2,7 @@
 #include <transport_catalogue.pb.h>
 
 #include <fstream>
+#include <stdexcept>
 TransportInformator::Serialize::Serializator::Serializator(TransportInformator::Core::TransportCatalogue &tc,
                                                            TransportInformator::Serialize::SerializationParameters pars) :
                                                            tc_{tc}, pars_{std::move(pars)}{}
@@ -9,7 +10,8 @@ TransportInformator::Serialize::Serializator::Serializator(TransportInformator::
 void TransportInformator::Serialize::Serializator::SerializeToFile
 (const TransportInformator::Render::RenderSettings& render_settings,
  const TransportInformator::Router::TransportRouterParameters& router_parameters,
- const TransportInformator::Router::TransportRouter& transport_router)
+ const TransportInformator::Router::TransportRouter& transport_router,
+ const std::string& rendered_map)
 {
     std::ofstream out(pars_.file, std::ios::binary);
 
@@ -46,6 +48,7 @@ void TransportInformator::Serialize::Serializator::SerializeToFile
         cur_id_to_span_count->set_span_count(span_count);
     }
 
+    result.set_rendered_map(rendered_map);
 
     result.SerializeToOstream(&out);
 }
@@ -53,52 +56,62 @@ void TransportInformator::Serialize::Serializator::SerializeToFile
 TransportInformator::Router::TransportRouter TransportInformator::Serialize::Serializator::UnserializeFromFile()
 {
     std::ifstream in(pars_.file, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Can't open database file " + pars_.file);
+    }
     db_serialization::TCWithSettings read_db_and_settings;
     if (!read_db_and_settings.ParseFromIstream(&in))
     {
-        assert(false);
+        throw std::runtime_error("Can't parse database file " + pars_.file);
     }
 
-    auto read_db = read_db_and_settings.tc();
+    const auto& read_db = read_db_and_settings.tc();
 
     int size_of_stops = read_db.stops().stops_size();
 
-    std::unordered_map<int, std::string_view> id_to_stop_name;
+    std::unordered_map<int, const Core::Stop*> id_to_stop;
+    id_to_stop.reserve(size_of_stops);
     for (int i = 0; i < size_of_stops; ++i)
     {
-        auto current_stop = read_db.stops().stops(i);
-        tc_.AddStop(current_stop.name(), {current_stop.coords().lat(), current_stop.coords().long_()});
-        id_to_stop_name[current_stop.id()] = tc_.FindStop(current_stop.name())->name;
+        const auto& current_stop = read_db.stops().stops(i);
+        id_to_stop[current_stop.id()] = tc_.AddStop(current_stop.name(), {current_stop.coords().lat(), current_stop.coords().long_()});
     }
 
     int size_of_distances = read_db.distances().distances_size();
     for (int i = 0; i < size_of_distances; ++i)
     {
-        auto current_distance = read_db.distances().distances(i);
-        tc_.SetDistanceBetweenStops(tc_.FindStop(id_to_stop_name[current_distance.stop_from()]),
-                                    tc_.FindStop(id_to_stop_name[current_distance.stop_to()]), current_distance.distance());
+        const auto& current_distance = read_db.distances().distances(i);
+        tc_.SetDistanceBetweenStops(id_to_stop[current_distance.stop_from()],
+                                    id_to_stop[current_distance.stop_to()], current_distance.distance());
     }
 
     int size_of_buses = read_db.buses().buses_size();
+    std::vector<const Core::Stop*> bus_stops;
     for (int i = 0; i < size_of_buses; ++i)
     {
-        auto current_bus = read_db.buses().buses(i);
+        const auto& current_bus = read_db.buses().buses(i);
 
-        std::vector<std::string> stop_names;
         int size_of_stops_in_this_bus = current_bus.stops_size();
+        bus_stops.clear();
+        bus_stops.reserve(size_of_stops_in_this_bus);
         for (int j = 0; j < size_of_stops_in_this_bus; ++j)
         {
-            std::string name(id_to_stop_name[current_bus.stops(j)]);
-            stop_names.push_back(std::move(name));
+            bus_stops.push_back(id_to_stop[current_bus.stops(j)]);
         }
 
-        tc_.AddBus(current_bus.name(), stop_names, current_bus.is_roundtrip());
+        tc_.AddBus(current_bus.name(), bus_stops, current_bus.is_roundtrip());
     }
 
     render_setings_ = DeserializeRenderSettings(read_db_and_settings.render_settings());
     router_settings_ = DeserializeRouterSettings(read_db_and_settings.router_settings());
 
     graph_ = DeserializeGraph(read_db_and_settings.transport_router().graph());
+    if (graph_->GetVertexCount() != 2 * static_cast<size_t>(size_of_stops))
+    {
+        throw std::runtime_error("Routing graph doesn't match stops in database file " + pars_.file);
+    }
+    rendered_map_ = read_db_and_settings.rendered_map();
 
     std::unordered_map<size_t, std::string> edge_id_to_bus_name;
     for (int i = 0; i < read_db_and_settings.transport_router().id_to_bus_name_size(); ++i)
@@ -150,7 +163,8 @@ db_serialization::RenderSettings TransportInformator::Serialize::Serializator::S
         db_serialization::Color* cur_color_ptr = result.add_color_palette();
         *cur_color_ptr = SerializeColor(color);
     }
-
+    result.set_simplification_tolerance(render_settings.simplification_tolerance);
+    result.set_label_culling(render_settings.label_culling);
 
 
     return result;
@@ -177,6 +191,8 @@ TransportInformator::Render::RenderSettings TransportInformator::Serialize::Seri
     {
         result.color_palette.push_back(DeserializeColor(render_settings.color_palette(i)));
     }
+    result.simplification_tolerance = render_settings.simplification_tolerance();
+    result.label_culling = render_settings.label_culling();
 
 
     return result;
@@ -261,6 +277,10 @@ TransportInformator::Serialize::Serializator::GetRouterSettings() const {
     return router_settings_;
 }
 
+const std::string& TransportInformator::Serialize::Serializator::GetRenderedMap() const {
+    return rendered_map_;
+}
+
 db_serialization::Graph
 TransportInformator::Serialize::Serializator::SerializeGraph(const graph::DirectedWeightedGraph<double> &graph) {
     db_serialization::Graph result;
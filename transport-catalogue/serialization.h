@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string>
 #include "transport_catalogue.h"
 #include "map_renderer.h"
@@ -19,11 +21,14 @@ namespace TransportInformator {
 
             void SerializeToFile(const TransportInformator::Render::RenderSettings& render_settings,
                                  const TransportInformator::Router::TransportRouterParameters& router_parameters,
-                                 const TransportInformator::Router::TransportRouter& transport_router);
+                                 const TransportInformator::Router::TransportRouter& transport_router,
+                                 const std::string& rendered_map);
             TransportInformator::Router::TransportRouter UnserializeFromFile();
 
             TransportInformator::Render::RenderSettings GetRenderSettings() const;
             TransportInformator::Router::TransportRouterParameters GetRouterSettings() const;
+            // SVG-карта, отрисованная при make_base; пустая строка, если в базе её нет
+            const std::string& GetRenderedMap() const;
             graph::DirectedWeightedGraph<double> GetGraph() const
             {
                 assert(graph_.has_value());
@@ -40,6 +45,7 @@ namespace TransportInformator {
             TransportInformator::Render::RenderSettings render_setings_;
             TransportInformator::Router::TransportRouterParameters router_settings_;
             std::optional<graph::DirectedWeightedGraph<double>> graph_;
+            std::string rendered_map_;
 
             static db_serialization::RenderSettings SerializeRenderSettings(const TransportInformator::Render::RenderSettings& render_settings);
             static TransportInformator::Render::RenderSettings DeserializeRenderSettings(const db_serialization::RenderSettings& render_settings);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+
+namespace TransportInformator
+{
+
+// Хранит текущий неизменяемый снимок данных.
+// Get и Reset можно вызывать из разных потоков одновременно: замена указателя атомарна,
+// читатели, уже получившие снимок, дорабатывают с ним, не дожидаясь перезагрузки,
+// а старый снимок освобождается вместе с последней ссылкой на него.
+template <typename T>
+class SnapshotHolder
+{
+    public:
+    SnapshotHolder() = default;
+    explicit SnapshotHolder(std::shared_ptr<const T> snapshot) : snapshot_{std::move(snapshot)} {}
+
+    SnapshotHolder(const SnapshotHolder&) = delete;
+    SnapshotHolder& operator=(const SnapshotHolder&) = delete;
+
+    std::shared_ptr<const T> Get() const
+    {
+        return std::atomic_load(&snapshot_);
+    }
+
+    void Reset(std::shared_ptr<const T> snapshot)
+    {
+        std::atomic_store(&snapshot_, std::move(snapshot));
+    }
+
+    private:
+    std::shared_ptr<const T> snapshot_;
+};
+
+} // namespace TransportInformator
@@ -0,0 +1,163 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace TransportInformator
+{
+
+namespace Core
+{
+
+namespace
+{
+    const double DEGREES_TO_RADIANS = 3.1415926535 / 180.;
+    // Отрезки не длиннее этого просматриваются целиком, без спуска по дереву
+    const size_t LEAF_SIZE = 8;
+    const double INITIAL_SEARCH_RADIUS = 100;
+    // Больше половины длины экватора: круг такого радиуса покрывает всю сферу
+    const double MAX_SEARCH_RADIUS = detail::EARTH_RADIUS * 4;
+
+    double GetAxis(const Stop* stop, bool by_lat)
+    {
+        return by_lat ? stop->coords.lat : stop->coords.lng;
+    }
+}
+
+StopsSpatialIndex::StopsSpatialIndex(std::vector<const Stop*> stops) : stops_{std::move(stops)}
+{
+    Build(0, stops_.size(), true);
+}
+
+void StopsSpatialIndex::Build(size_t begin, size_t end, bool split_by_lat)
+{
+    if (end - begin <= LEAF_SIZE)
+    {
+        return;
+    }
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(stops_.begin() + begin, stops_.begin() + mid, stops_.begin() + end,
+        [split_by_lat](const Stop* lhs, const Stop* rhs) { return GetAxis(lhs, split_by_lat) < GetAxis(rhs, split_by_lat); });
+    Build(begin, mid, !split_by_lat);
+    Build(mid + 1, end, !split_by_lat);
+}
+
+void StopsSpatialIndex::CollectInBox(size_t begin, size_t end, bool split_by_lat, const Box& box,
+                                     detail::Coordinates center, double radius, std::vector<NearbyStop>& result) const
+{
+    // Проверка прямоугольника нужна, когда он ищется в два прохода (см. FindInRadius):
+    // лист может попасть в оба, но остановка учитывается только в одном из них
+    auto check_stop = [&](const Stop* stop)
+    {
+        if (stop->coords.lng < box.lng_from || box.lng_to < stop->coords.lng)
+        {
+            return;
+        }
+        const double distance = detail::ComputeDistance(center, stop->coords);
+        if (distance <= radius)
+        {
+            result.push_back({stop->name, distance});
+        }
+    };
+
+    if (end - begin <= LEAF_SIZE)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            check_stop(stops_[i]);
+        }
+        return;
+    }
+
+    const size_t mid = begin + (end - begin) / 2;
+    const double split_value = GetAxis(stops_[mid], split_by_lat);
+    const double box_from = split_by_lat ? box.lat_from : box.lng_from;
+    const double box_to = split_by_lat ? box.lat_to : box.lng_to;
+
+    if (box_from <= split_value && split_value <= box_to)
+    {
+        check_stop(stops_[mid]);
+    }
+    if (box_from <= split_value)
+    {
+        CollectInBox(begin, mid, !split_by_lat, box, center, radius, result);
+    }
+    if (split_value <= box_to)
+    {
+        CollectInBox(mid + 1, end, !split_by_lat, box, center, radius, result);
+    }
+}
+
+std::vector<NearbyStop> StopsSpatialIndex::FindInRadius(detail::Coordinates center, double radius, size_t max_count) const
+{
+    std::vector<NearbyStop> result;
+    if (stops_.empty() || radius < 0)
+    {
+        return result;
+    }
+
+    // Прямоугольник в градусах, гарантированно содержащий круг поиска (с небольшим запасом)
+    const double delta_lat = radius / detail::EARTH_RADIUS / DEGREES_TO_RADIANS * 1.001;
+    Box box{center.lat - delta_lat, center.lat + delta_lat, -360., 360.};
+    if (box.lat_from > -90. && box.lat_to < 90.)
+    {
+        const double max_abs_lat = std::max(std::abs(box.lat_from), std::abs(box.lat_to));
+        const double delta_lng = delta_lat / std::cos(max_abs_lat * DEGREES_TO_RADIANS);
+        if (delta_lng < 180.)
+        {
+            box.lng_from = center.lng - delta_lng;
+            box.lng_to = center.lng + delta_lng;
+        }
+    }
+
+    CollectInBox(0, stops_.size(), true, box, center, radius, result);
+    // Долготы остановок лежат в [-180, 180]: часть прямоугольника за антимеридианом
+    // ищем ещё раз, сдвинув на полный оборот. Ширина прямоугольника меньше 360°,
+    // поэтому сдвинутый прямоугольник не пересекается с исходным
+    if (box.lng_from < -180.)
+    {
+        CollectInBox(0, stops_.size(), true, {box.lat_from, box.lat_to, box.lng_from + 360., box.lng_to + 360.},
+                     center, radius, result);
+    }
+    if (box.lng_to > 180.)
+    {
+        CollectInBox(0, stops_.size(), true, {box.lat_from, box.lat_to, box.lng_from - 360., box.lng_to - 360.},
+                     center, radius, result);
+    }
+
+    std::sort(result.begin(), result.end(), [](const NearbyStop& lhs, const NearbyStop& rhs)
+    {
+        return std::tie(lhs.distance, lhs.name) < std::tie(rhs.distance, rhs.name);
+    });
+    if (result.size() > max_count)
+    {
+        result.resize(max_count);
+    }
+    return result;
+}
+
+std::vector<NearbyStop> StopsSpatialIndex::FindNearest(detail::Coordinates center, size_t count) const
+{
+    if (stops_.empty() || count == 0)
+    {
+        return {};
+    }
+
+    // Расширяем круг поиска, пока в него не попадёт count остановок:
+    // все остановки внутри круга найдены точно, значит ближайшие среди них
+    double radius = INITIAL_SEARCH_RADIUS;
+    while (true)
+    {
+        std::vector<NearbyStop> result = FindInRadius(center, radius, count);
+        if (result.size() == count || radius >= MAX_SEARCH_RADIUS)
+        {
+            return result;
+        }
+        radius *= 2;
+    }
+}
+
+} // namespace TransportInformator::Core
+
+} // namespace TransportInformator
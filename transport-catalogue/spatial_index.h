@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "geo.h"
+#include "domain.h"
+
+namespace TransportInformator
+{
+
+namespace Core
+{
+
+// Неявное k-d дерево по широте и долготе остановок: медиана каждого отрезка массива
+// делит его по очередной оси. Строится один раз после загрузки справочника,
+// дальше используется только на чтение.
+class StopsSpatialIndex
+{
+    public:
+    StopsSpatialIndex() = default;
+    explicit StopsSpatialIndex(std::vector<const Stop*> stops);
+
+    // Остановки не дальше radius метров от center, по возрастанию расстояния
+    std::vector<NearbyStop> FindInRadius(detail::Coordinates center, double radius, size_t max_count) const;
+
+    // count ближайших к center остановок, по возрастанию расстояния
+    std::vector<NearbyStop> FindNearest(detail::Coordinates center, size_t count) const;
+
+    private:
+    struct Box
+    {
+        double lat_from;
+        double lat_to;
+        double lng_from;
+        double lng_to;
+    };
+
+    void Build(size_t begin, size_t end, bool split_by_lat);
+    void CollectInBox(size_t begin, size_t end, bool split_by_lat, const Box& box,
+                      detail::Coordinates center, double radius, std::vector<NearbyStop>& result) const;
+
+    std::vector<const Stop*> stops_;
+};
+
+} // namespace TransportInformator::Core
+
+} // namespace TransportInformator
@@ -1,10 +1,12 @@
 #include "svg.h"
+#include "number_format.h"
 #include <sstream>
 
 namespace svg
 {
 
     using namespace std::literals;
+    using TransportInformator::detail::WriteNumber;
 
     Rgb::Rgb(uint8_t r, uint8_t g, uint8_t b) : red(r), green(g), blue(b) {}
 
@@ -14,14 +16,26 @@ namespace svg
     void ColorToOstream::operator()(const std::string color_string) const { out << color_string; }
     void ColorToOstream::operator()(const Rgb &rgb_struct) const
     {
-        out << "rgb(" << std::to_string(rgb_struct.red) << "," << std::to_string(rgb_struct.green) << ","
-           << std::to_string(rgb_struct.blue) << ")";
+        out << "rgb("sv;
+        WriteNumber(out, rgb_struct.red);
+        out << ',';
+        WriteNumber(out, rgb_struct.green);
+        out << ',';
+        WriteNumber(out, rgb_struct.blue);
+        out << ')';
     }
 
     void ColorToOstream::operator()(const Rgba &rgba_struct) const
     {
-        out << "rgba(" << std::to_string(rgba_struct.red) << ',' << std::to_string(rgba_struct.green)
-           << ',' << std::to_string(rgba_struct.blue) << ',' << rgba_struct.opacity << ')';
+        out << "rgba("sv;
+        WriteNumber(out, rgba_struct.red);
+        out << ',';
+        WriteNumber(out, rgba_struct.green);
+        out << ',';
+        WriteNumber(out, rgba_struct.blue);
+        out << ',';
+        WriteNumber(out, rgba_struct.opacity);
+        out << ')';
     }
 
     void Object::Render(const RenderContext &context) const
@@ -31,7 +45,7 @@ namespace svg
         // Делегируем вывод тега своим подклассам
         RenderObject(context);
 
-        context.out << std::endl;
+        context.out << '\n';
     }
 
     // ---------- Circle ------------------
@@ -53,8 +67,13 @@ namespace svg
         auto &out = context.out;
         out << "  <circle";
         
-        out << " cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-        out << "r=\""sv << radius_ << "\""sv;
+        out << " cx=\""sv;
+        WriteNumber(out, center_.x);
+        out << "\" cy=\""sv;
+        WriteNumber(out, center_.y);
+        out << "\" r=\""sv;
+        WriteNumber(out, radius_);
+        out << "\""sv;
         RenderAttrs(out);
         
         out << "/>"sv;
@@ -78,7 +97,9 @@ namespace svg
 
         for (auto it = polyline_points_.begin(); it != polyline_points_.end(); ++it)
         {
-            out << it->x << ',' << it->y;
+            WriteNumber(out, it->x);
+            out << ',';
+            WriteNumber(out, it->y);
             if (it != std::prev(polyline_points_.end()))
             {
                 out << ' ';
@@ -142,8 +163,15 @@ namespace svg
         
         out << "  <text";
         RenderAttrs(out);
-        out << " x=\"" << starting_point_.x << "\" y=\"" << starting_point_.y << "\" ";
-        out << "dx=\"" << offset_.x << "\" dy=\"" << offset_.y << "\" ";
+        out << " x=\""sv;
+        WriteNumber(out, starting_point_.x);
+        out << "\" y=\""sv;
+        WriteNumber(out, starting_point_.y);
+        out << "\" dx=\""sv;
+        WriteNumber(out, offset_.x);
+        out << "\" dy=\""sv;
+        WriteNumber(out, offset_.y);
+        out << "\" "sv;
         out << "font-size=\"" << font_size_ << "\"";
         if (!font_family_.empty())
         {
@@ -157,41 +185,55 @@ namespace svg
         }
         
         out << ">";
-        out << PrepateTextForSVG();
+        RenderData(out);
 
         out << "</text>";
     }
 
-    std::string Text::PrepateTextForSVG() const
+    void Text::RenderData(std::ostream &out) const
     {
-        std::stringstream ss;
-
         for (const char &c : data_)
         {
             switch (c)
             {
             case '\"':
-                ss << "&quot;";
+                out << "&quot;";
                 break;
             case '\'':
-                ss << "&apos;";
+                out << "&apos;";
                 break;
             case '<':
-                ss << "&lt;";
+                out << "&lt;";
                 break;
             case '>':
-                ss << "&gt;";
+                out << "&gt;";
                 break;
             case '&':
-                ss << "&amp;";
+                out << "&amp;";
                 break;
             default:
-                ss << c;
+                out.put(c);
                 break;
             }
         }
-        return ss.str();
     }
+    // -----------------ObjectContainer--------------
+
+    void ObjectContainer::Add(Circle circle)
+    {
+        AddPtr(std::make_unique<Circle>(std::move(circle)));
+    }
+
+    void ObjectContainer::Add(Polyline polyline)
+    {
+        AddPtr(std::make_unique<Polyline>(std::move(polyline)));
+    }
+
+    void ObjectContainer::Add(Text text)
+    {
+        AddPtr(std::make_unique<Text>(std::move(text)));
+    }
+
     // -----------------Document--------------------
     /*
          Метод Add добавляет в svg-документ любой объект-наследник svg::Object.
@@ -200,10 +242,62 @@ namespace svg
          doc.Add(Circle().SetCenter({20, 30}).SetRadius(15));
         */
 
+    void Document::Add(Circle circle)
+    {
+        circles_.push_back(std::move(circle));
+        AddRef(ObjectKind::CIRCLE, circles_.size() - 1);
+    }
+
+    void Document::Add(Polyline polyline)
+    {
+        polylines_.push_back(std::move(polyline));
+        AddRef(ObjectKind::POLYLINE, polylines_.size() - 1);
+    }
+
+    void Document::Add(Text text)
+    {
+        texts_.push_back(std::move(text));
+        AddRef(ObjectKind::TEXT, texts_.size() - 1);
+    }
+
     // Добавляет в svg-документ объект-наследник svg::Object
     void Document::AddPtr(std::unique_ptr<Object> &&obj)
     {
-        objects_.push_back(std::move(obj));
+        other_objects_.push_back(std::move(obj));
+        AddRef(ObjectKind::OTHER, other_objects_.size() - 1);
+    }
+
+    void Document::Reserve(size_t circles, size_t polylines, size_t texts)
+    {
+        circles_.reserve(circles);
+        polylines_.reserve(polylines);
+        texts_.reserve(texts);
+        objects_.reserve(objects_.size() + circles + polylines + texts);
+    }
+
+    void Document::Clear()
+    {
+        circles_.clear();
+        polylines_.clear();
+        texts_.clear();
+        other_objects_.clear();
+        objects_.clear();
+    }
+
+    void Document::AddRef(ObjectKind kind, size_t index)
+    {
+        objects_.push_back({kind, static_cast<uint32_t>(index)});
+    }
+
+    void RenderDocumentBegin(std::ostream &out)
+    {
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>" << std::endl;
+        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">" << std::endl;
+    }
+
+    void RenderDocumentEnd(std::ostream &out)
+    {
+        out << "</svg>";
     }
 
     // Выводит в ostream svg-представление документа
@@ -211,17 +305,70 @@ namespace svg
     {
         RenderContext context{out};
 
-        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>" << std::endl;
-        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">" << std::endl;
+        RenderDocumentBegin(out);
 
-        for (const auto &obj : objects_)
+        // Circle, Polyline и Text объявлены final, поэтому RenderObject для них вызывается напрямую
+        for (const ObjectRef &ref : objects_)
         {
-            obj->Render(context);
+            switch (ref.kind)
+            {
+            case ObjectKind::CIRCLE:
+                context.RenderIndent();
+                circles_[ref.index].RenderObject(context);
+                out << '\n';
+                break;
+            case ObjectKind::POLYLINE:
+                context.RenderIndent();
+                polylines_[ref.index].RenderObject(context);
+                out << '\n';
+                break;
+            case ObjectKind::TEXT:
+                context.RenderIndent();
+                texts_[ref.index].RenderObject(context);
+                out << '\n';
+                break;
+            case ObjectKind::OTHER:
+                other_objects_[ref.index]->Render(context);
+                break;
+            }
         }
 
-        out << "</svg>";
+        RenderDocumentEnd(out);
+    }
+
+    // -----------------StreamWriter-----------------
+
+    StreamWriter::StreamWriter(std::ostream &out) : context_{out}
+    {
+    }
+
+    void StreamWriter::Add(Circle circle)
+    {
+        context_.RenderIndent();
+        circle.RenderObject(context_);
+        context_.out << '\n';
+    }
+
+    void StreamWriter::Add(Polyline polyline)
+    {
+        context_.RenderIndent();
+        polyline.RenderObject(context_);
+        context_.out << '\n';
+    }
+
+    void StreamWriter::Add(Text text)
+    {
+        context_.RenderIndent();
+        text.RenderObject(context_);
+        context_.out << '\n';
     }
 
+    void StreamWriter::AddPtr(std::unique_ptr<Object> &&obj)
+    {
+        obj->Render(context_);
+    }
+
+
     std::ostream &operator<<(std::ostream &out, StrokeLineCap stroke)
     {
         switch (stroke)
@@ -8,6 +8,8 @@
 #include <optional>
 #include <variant>
 
+#include "number_format.h"
+
 namespace svg
 {
 
@@ -74,6 +76,9 @@ namespace svg
     std::ostream &operator<<(std::ostream &out, StrokeLineJoin stroke);
 
     struct RenderContext;
+    class Circle;
+    class Polyline;
+    class Text;
 
     class Object
     {
@@ -92,6 +97,12 @@ namespace svg
         template <typename Obj>
         void Add(Obj obj);
 
+        // Контейнеры, умеющие работать с базовыми фигурами без выделения памяти, переопределяют
+        // эти методы; по умолчанию фигура, как и любой другой объект, передаётся в AddPtr
+        virtual void Add(Circle circle);
+        virtual void Add(Polyline polyline);
+        virtual void Add(Text text);
+
         virtual void AddPtr(std::unique_ptr<Object> &&obj) = 0;
 
         virtual ~ObjectContainer() = default;
@@ -116,6 +127,12 @@ namespace svg
         Owner &SetStrokeLineJoin(StrokeLineJoin line_join);
 
     protected:
+        PathProps() = default;
+        // Перемещение объявлено явно: без него защищённый деструктор оставил бы только копирование
+        PathProps(const PathProps &) = default;
+        PathProps(PathProps &&) noexcept = default;
+        PathProps &operator=(const PathProps &) = default;
+        PathProps &operator=(PathProps &&) noexcept = default;
         ~PathProps() = default;
 
         void RenderAttrs(std::ostream &out) const
@@ -132,7 +149,9 @@ namespace svg
             }
             if (stroke_width_)
             {
-                out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
+                out << " stroke-width=\""sv;
+                TransportInformator::detail::WriteNumber(out, *stroke_width_);
+                out << "\""sv;
             }
             if (line_cap_)
             {
@@ -214,6 +233,8 @@ namespace svg
         Circle &SetRadius(double radius);
 
     private:
+        friend class Document;
+        friend class StreamWriter;
         void RenderObject(const RenderContext &context) const override;
 
         Point center_;
@@ -231,6 +252,8 @@ namespace svg
         Polyline &AddPoint(Point point);
 
     private:
+        friend class Document;
+        friend class StreamWriter;
         void RenderObject(const RenderContext &context) const override;
         std::vector<Point> polyline_points_;
     };
@@ -261,9 +284,12 @@ namespace svg
         Text &SetData(std::string data);
 
     private:
+        friend class Document;
+        friend class StreamWriter;
         void RenderObject(const RenderContext &context) const override;
 
-        std::string PrepateTextForSVG() const;
+        // Выводит текст, заменяя спецсимволы XML на сущности
+        void RenderData(std::ostream &out) const;
 
         Point starting_point_;
         Point offset_;
@@ -273,6 +299,12 @@ namespace svg
         std::string data_;
     };
 
+    /*
+     * Circle, Polyline и Text хранятся по значению в отдельном массиве для каждого типа,
+     * порядок вывода задаёт общий список ссылок на них. Такие объекты не требуют
+     * отдельного выделения памяти и выводятся без виртуальных вызовов.
+     * Прочие наследники Object хранятся по указателю.
+     */
     class Document : public ObjectContainer
     {
     public:
@@ -282,6 +314,11 @@ namespace svg
          Document doc;
          doc.Add(Circle().SetCenter({20, 30}).SetRadius(15));
         */
+        using ObjectContainer::Add;
+
+        void Add(Circle circle) override;
+        void Add(Polyline polyline) override;
+        void Add(Text text) override;
 
         // Добавляет в svg-документ объект-наследник svg::Object
         void AddPtr(std::unique_ptr<Object> &&obj) override;
@@ -289,8 +326,62 @@ namespace svg
         // Выводит в ostream svg-представление документа
         void Render(std::ostream &out) const;
 
+        // Заранее выделяет память под заданное число объектов каждого типа
+        void Reserve(size_t circles, size_t polylines, size_t texts);
+
+        // Удаляет все объекты, сохраняя выделенную под них память для следующей отрисовки
+        void Clear();
+
+    private:
+        enum class ObjectKind : uint8_t
+        {
+            CIRCLE,
+            POLYLINE,
+            TEXT,
+            OTHER,
+        };
+
+        struct ObjectRef
+        {
+            ObjectKind kind;
+            uint32_t index;
+        };
+
+        void AddRef(ObjectKind kind, size_t index);
+
+        std::vector<Circle> circles_;
+        std::vector<Polyline> polylines_;
+        std::vector<Text> texts_;
+        std::vector<std::unique_ptr<Object>> other_objects_;
+        // объекты в порядке добавления
+        std::vector<ObjectRef> objects_;
+    };
+
+    // Пролог и закрывающий тег SVG-документа; между ними выводятся объекты
+    void RenderDocumentBegin(std::ostream &out);
+    void RenderDocumentEnd(std::ostream &out);
+
+    /*
+     * Выводит объекты в поток сразу при добавлении, ничего не храня, поэтому память
+     * не зависит от размера изображения. Объекты выводятся так же, как в Document;
+     * пролог и закрывающий тег документа выводятся отдельно, поэтому несколько
+     * StreamWriter могут готовить части одного документа.
+     */
+    class StreamWriter : public ObjectContainer
+    {
+    public:
+        explicit StreamWriter(std::ostream &out);
+
+        using ObjectContainer::Add;
+
+        void Add(Circle circle) override;
+        void Add(Polyline polyline) override;
+        void Add(Text text) override;
+
+        void AddPtr(std::unique_ptr<Object> &&obj) override;
+
     private:
-        std::vector<std::unique_ptr<Object>> objects_;
+        RenderContext context_;
     };
 
     template <typename Obj>
@@ -1,9 +1,11 @@
 #include "transport_catalogue.h"
 #include "geo.h"
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <numeric>
+#include <cassert>
 
 namespace TransportInformator
 {
@@ -11,44 +13,48 @@ namespace TransportInformator
 namespace Core
 {
 
-void TransportCatalogue::AddStop(std::string_view name, detail::Coordinates coords)
+const Stop* TransportCatalogue::AddStop(std::string_view name, detail::Coordinates coords)
 {
-    stops_.push_back({std::string(name), coords});
-    std::string_view new_stop_name(stops_.back().name);
-    stops_index_[new_stop_name] = &stops_.back();
-    stops_to_buses_[new_stop_name];
+    assert(!frozen_);
+    stops_.push_back({arena_.CopyString(name), coords, static_cast<uint32_t>(stops_.size())});
+    Stop* new_stop = &stops_.back();
+    stops_index_[new_stop->name] = new_stop;
+    stops_to_buses_.emplace_back();
+    return new_stop;
 }
 
-Stop *TransportCatalogue::FindStop(std::string_view name) const
+const Stop *TransportCatalogue::FindStop(std::string_view name) const
 {
-    if (!stops_index_.count(name))
-    {
-        return nullptr;
-    }
-    return stops_index_.at(name);
+    const auto it = stops_index_.find(name);
+    return it == stops_index_.end() ? nullptr : it->second;
 }
 
-void TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string> &stop_names, bool is_roundtrip)
+void TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string_view> &stop_names, bool is_roundtrip)
 {
     std::vector<const Stop *> stops_pointers;
     stops_pointers.reserve(stop_names.size());
-    for (const std::string &name : stop_names)
+    for (const std::string_view name : stop_names)
     {
         const Stop *stop_ptr = FindStop(name);
         stops_pointers.push_back(stop_ptr);
     }
+    AddBus(name, stops_pointers, is_roundtrip);
+}
 
-    buses_.push_back({std::string(name), stops_pointers, is_roundtrip});
+void TransportCatalogue::AddBus(std::string_view name, const std::vector<const Stop*> &stops, bool is_roundtrip)
+{
+    assert(!frozen_);
+    buses_.push_back({arena_.CopyString(name), arena_.CopyArray(stops), is_roundtrip});
     std::string_view new_bus_name(buses_.back().name);
     buses_index_[new_bus_name] = &buses_.back();
 
     for (const Stop *stop : buses_.back().stops)
     {
-        stops_to_buses_[stop->name].insert(new_bus_name);
+        stops_to_buses_[stop->id].insert(new_bus_name);
     }
 }
 
-Bus* TransportCatalogue::FindBus(std::string_view name) const
+const Bus* TransportCatalogue::FindBus(std::string_view name) const
 {
     return buses_index_.at(name);
 }
@@ -64,58 +70,69 @@ std::optional<BusInfo> TransportCatalogue::GetBusInfo(std::string_view name) con
 
     size_t number_of_stops = bus_ref.is_roundtrip ? bus_ref.stops.size() : 2 * bus_ref.stops.size() - 1;
 
-    std::set<const Stop *> unique_stops{bus_ref.stops.begin(), bus_ref.stops.end()};
+    // Повторяющиеся остановки оказываются рядом в упорядоченной копии: одно выделение памяти вместо узла на остановку
+    std::vector<const Stop*> sorted_stops{bus_ref.stops.begin(), bus_ref.stops.end()};
+    std::sort(sorted_stops.begin(), sorted_stops.end());
+    const size_t unique_stops = std::unique(sorted_stops.begin(), sorted_stops.end()) - sorted_stops.begin();
+
+    // Геодезические длины отрезков маршрута считаются одним пакетом
+    std::vector<detail::Coordinates> stops_coords;
+    stops_coords.reserve(bus_ref.stops.size());
+    for (const Stop* stop : bus_ref.stops)
+    {
+        stops_coords.push_back(stop->coords);
+    }
+    const size_t segments = stops_coords.empty() ? 0 : stops_coords.size() - 1;
+    std::vector<double> segment_distances(segments);
+    detail::ComputeDistancesAlongPath(stops_coords.data(), stops_coords.size(), segment_distances.data());
 
     double geographic_distance = 0.0;
     double real_distance = 0.0;
 
-    if (bus_ref.is_roundtrip)
+    for (size_t i = 0; i < segments; ++i)
     {
-        for (auto it = std::next(bus_ref.stops.begin(), 1); it != bus_ref.stops.end(); ++it)
-        {
-            geographic_distance += ComputeDistance((*it)->coords, (*(std::next(it, -1)))->coords);
-            real_distance += GetDistanceBetweenStops(*std::next(it, -1), *it);
-        }
-    } else {
-        for (auto it = std::next(bus_ref.stops.begin(), 1); it != bus_ref.stops.end(); ++it)
-        {
-            geographic_distance += ComputeDistance((*it)->coords, (*(std::next(it, -1)))->coords);
-            real_distance += GetDistanceBetweenStops(*std::next(it, -1), *it);
-        }
+        geographic_distance += segment_distances[i];
+        real_distance += GetDistanceBetweenStops(bus_ref.stops[i], bus_ref.stops[i + 1]);
+    }
 
-        for (auto it = std::next(bus_ref.stops.end(), -1); it != bus_ref.stops.begin(); --it)
+    if (!bus_ref.is_roundtrip)
+    {
+        for (size_t i = segments; i > 0; --i)
         {
-            geographic_distance += ComputeDistance((*it)->coords, (*(std::next(it, -1)))->coords);
-            real_distance += GetDistanceBetweenStops(*it, *std::next(it, -1));
+            geographic_distance += segment_distances[i - 1];
+            real_distance += GetDistanceBetweenStops(bus_ref.stops[i], bus_ref.stops[i - 1]);
         }
     }
 
-    
-
     double curvature = real_distance / geographic_distance;
 
-    BusInfo result{bus_ref.name, number_of_stops, unique_stops.size(), real_distance, curvature};
+    BusInfo result{bus_ref.name, number_of_stops, unique_stops, real_distance, curvature};
     return result;
 }
 
 std::optional<StopInfo> TransportCatalogue::GetStopInfo(std::string_view name) const
 {
-    if (!stops_index_.count(name))
+    const Stop* stop = FindStop(name);
+    if (!stop)
     {
         return {};
     }
-    StopInfo result{name, stops_to_buses_.at(name)};
+    StopInfo result{name, stops_to_buses_[stop->id]};
     return result;
 }
 
 void TransportCatalogue::SetDistanceBetweenStops(const Stop *from, const Stop *to, double distance)
 {
-    distances_[{from, to}] = distance;
+    assert(!frozen_);
+    distances_.insert_or_assign({from, to}, distance);
+    // обратное расстояние задаётся, только если его не указали явно
+    distances_.try_emplace({to, from}, distance);
+}
 
-    if (!distances_.count({to, from}))
-    {
-        distances_[{to, from}] = distance;
-    }
+void TransportCatalogue::ReserveDistances(size_t count)
+{
+    assert(!frozen_);
+    distances_.reserve(count);
 }
 
 double TransportCatalogue::GetDistanceBetweenStops(const Stop *from, const Stop *to) const
@@ -138,9 +155,9 @@ std::set<std::string_view> TransportCatalogue::GetAllNonEmptyBuses() const
 
 std::set<std::string_view> TransportCatalogue::GetBusesForStop(std::string_view stop_name) const
 {
-    if (stops_to_buses_.count(stop_name))
+    if (const Stop* stop = FindStop(stop_name))
     {
-        return stops_to_buses_.at(stop_name);
+        return stops_to_buses_[stop->id];
     }
     return {};
 }
@@ -150,7 +167,7 @@ std::vector<detail::Coordinates> TransportCatalogue::GetBusStopCoordsForBus(std:
     std::vector<detail::Coordinates> result;
     if (buses_index_.count(bus_name))
     {
-        Bus* bus_ref = buses_index_.at(bus_name);
+        const Bus* bus_ref = buses_index_.at(bus_name);
         for (const auto& stop : bus_ref->stops)
         {
             result.push_back(stop->coords);
@@ -166,7 +183,7 @@ std::set<std::string_view> TransportCatalogue::GetAllNonEmptyStops() const
 
     for (const auto& [stop_name, stop_ptr] : stops_index_)
     {
-        if (!stops_to_buses_.at(stop_name).empty())
+        if (!stops_to_buses_[stop_ptr->id].empty())
         {
             result.insert(stop_name);
         }
@@ -190,7 +207,7 @@ std::vector<detail::Coordinates> TransportCatalogue::GetAllNonEmptyStopsCoords()
 
     for (const auto& [stop_name, stop_ptr] : stops_index_)
     {
-        if (!stops_to_buses_.at(stop_name).empty())
+        if (!stops_to_buses_[stop_ptr->id].empty())
         {
             result.push_back(stop_ptr->coords);
         }
@@ -198,35 +215,68 @@ std::vector<detail::Coordinates> TransportCatalogue::GetAllNonEmptyStopsCoords()
     return result;
 }
 
+std::shared_ptr<const TransportCatalogue> TransportCatalogue::Freeze(std::shared_ptr<TransportCatalogue> tc)
+{
+    // Снимок должен быть единственным владельцем, иначе справочник можно изменить в обход него
+    assert(tc.use_count() == 1);
+    if (!tc->spatial_index_.has_value())
+    {
+        tc->BuildSpatialIndex();
+    }
+    tc->frozen_ = true;
+    return tc;
+}
+
+void TransportCatalogue::BuildSpatialIndex()
+{
+    assert(!frozen_);
+    std::vector<const Stop*> all_stops;
+    all_stops.reserve(stops_.size());
+    for (const Stop& stop : stops_)
+    {
+        all_stops.push_back(&stop);
+    }
+    spatial_index_.emplace(std::move(all_stops));
+}
+
+std::vector<NearbyStop> TransportCatalogue::FindStopsInRadius(detail::Coordinates center, double radius, size_t max_count) const
+{
+    assert(spatial_index_.has_value());
+    return spatial_index_->FindInRadius(center, radius, max_count);
+}
+
+std::vector<NearbyStop> TransportCatalogue::FindNearestStops(detail::Coordinates center, size_t count) const
+{
+    assert(spatial_index_.has_value());
+    return spatial_index_->FindNearest(center, count);
+}
+
     db_serialization::TransportCatalogue TransportCatalogue::DumpDB() const
     {
         db_serialization::TransportCatalogue result;
         db_serialization::AllStops* all_stops = result.mutable_stops();
 
-        int i = 0;
-        std::unordered_map<std::string_view, int> stop_name_to_id;
+        // Stop::id — номер остановки в stops_, он же её номер в сохранённой базе
         for (const auto& stop : stops_)
         {
             db_serialization::Stop* cur_stop = all_stops->add_stops();
-            cur_stop->set_name(stop.name);
+            cur_stop->set_name(static_cast<std::string>(stop.name));
             db_serialization::Coords* coords_to_fill = cur_stop->mutable_coords();
             coords_to_fill->set_long_(stop.coords.lng);
             coords_to_fill->set_lat(stop.coords.lat);
-            cur_stop->set_id(i);
-            stop_name_to_id[stop.name] = i;
-            ++i;
+            cur_stop->set_id(stop.id);
         }
 
         db_serialization::AllBuses* all_buses = result.mutable_buses();
         for (const auto& bus : buses_)
         {
             db_serialization::Bus* cur_bus = all_buses->add_buses();
-            cur_bus->set_name(bus.name);
+            cur_bus->set_name(static_cast<std::string>(bus.name));
             cur_bus->set_is_roundtrip(bus.is_roundtrip);
 
             for (const auto& stop_ptr : bus.stops)
             {
-                 cur_bus->add_stops(stop_name_to_id[stop_ptr->name]);
+                 cur_bus->add_stops(stop_ptr->id);
             }
         }
 
@@ -234,8 +284,8 @@ std::vector<detail::Coordinates> TransportCatalogue::GetAllNonEmptyStopsCoords()
         for (const auto& [stops_ids, distance] : distances_)
         {
            db_serialization::StopsDistance* cur_dist = all_distances->add_distances();
-           cur_dist->set_stop_from(stop_name_to_id[stops_ids.first->name]);
-           cur_dist->set_stop_to(stop_name_to_id[stops_ids.second->name]);
+           cur_dist->set_stop_from(stops_ids.first->id);
+           cur_dist->set_stop_to(stops_ids.second->id);
            cur_dist->set_distance(distance);
         }
 
@@ -7,8 +7,11 @@
 #include <unordered_map>
 #include <optional>
 #include <set>
+#include <memory>
 
 #include "geo.h"
+#include "arena.h"
+#include "spatial_index.h"
 #include "domain.h"
 #include <transport_catalogue.pb.h>
 
@@ -23,18 +26,23 @@ class TransportCatalogue
     public:
     TransportCatalogue() = default;
 
-    void AddStop(std::string_view name, detail::Coordinates coords);
+    // Возвращает добавленную остановку: по указателю на неё можно ссылаться без повторного поиска по имени
+    const Stop* AddStop(std::string_view name, detail::Coordinates coords);
 
-    Stop* FindStop(std::string_view name) const;
+    const Stop* FindStop(std::string_view name) const;
 
-    void AddBus(std::string_view name, const std::vector<std::string>& stop_names, bool is_roundtrip);
+    void AddBus(std::string_view name, const std::vector<std::string_view>& stop_names, bool is_roundtrip);
+    // Маршрут из уже найденных остановок справочника
+    void AddBus(std::string_view name, const std::vector<const Stop*>& stops, bool is_roundtrip);
 
-    Bus* FindBus(std::string_view name) const;
+    const Bus* FindBus(std::string_view name) const;
 
     std::optional<BusInfo> GetBusInfo(std::string_view name) const;
     std::optional<StopInfo> GetStopInfo(std::string_view name) const;
 
     void SetDistanceBetweenStops(const Stop* from, const Stop* to, double distance);
+    // Готовит место для count расстояний, чтобы их добавление не перестраивало таблицу
+    void ReserveDistances(size_t count);
 
     double GetDistanceBetweenStops(const Stop* from, const Stop* to) const;
 
@@ -48,17 +56,30 @@ class TransportCatalogue
     std::set<std::string_view> GetBusesForStop(std::string_view stop_name) const;
     std::vector<detail::Coordinates> GetBusStopCoordsForBus(std::string_view bus_name) const;
 
+    // Превращает заполненный справочник в неизменяемый снимок: достраивает индексы и
+    // оставляет доступ только через указатель на константный объект. Константные методы
+    // снимка ничего не изменяют и могут вызываться из любого числа потоков без блокировок.
+    static std::shared_ptr<const TransportCatalogue> Freeze(std::shared_ptr<TransportCatalogue> tc);
+
+    // Строит пространственный индекс остановок; вызывается после загрузки справочника
+    void BuildSpatialIndex();
+    std::vector<NearbyStop> FindStopsInRadius(detail::Coordinates center, double radius, size_t max_count) const;
+    std::vector<NearbyStop> FindNearestStops(detail::Coordinates center, size_t count) const;
+
     db_serialization::TransportCatalogue DumpDB() const;
 
     private:
 
+    detail::MonotonicArena arena_;
+
     std::deque<Stop> stops_;
     std::unordered_map<std::string_view, Stop*> stops_index_;
 
     std::deque<Bus> buses_;
     std::unordered_map<std::string_view, Bus*> buses_index_;
 
-    std::unordered_map<std::string_view, std::set<std::string_view>> stops_to_buses_;
+    // автобусы, проходящие через остановку, по её номеру Stop::id
+    std::vector<std::set<std::string_view>> stops_to_buses_;
 
     struct PairStopsHasher
     {
@@ -69,6 +90,10 @@ class TransportCatalogue
     };
 
     std::unordered_map<std::pair<const Stop*, const Stop*>, double, PairStopsHasher> distances_;
+
+    std::optional<StopsSpatialIndex> spatial_index_;
+
+    bool frozen_ = false;
     
 };
 
@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base_reloader.h"
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "svg.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+/*
+ * Бенчмарки справочника на синтетической сети заданного размера.
+ * Сеть строится детерминированно по зерну, поэтому при одинаковых параметрах замеры
+ * разных версий программы выполняются на одних и тех же данных.
+ * Результаты выводятся в JSON: для каждого замера — время итераций и время на один элемент
+ */
+
+using namespace std::literals;
+using namespace TransportInformator;
+
+namespace {
+
+struct BenchConfig {
+    int stops = 300;
+    int buses = 40;
+    int stops_per_bus = 20;
+    int queries = 10000;
+    int repeat = 5;
+    int seed = 1;
+    std::string output;
+    std::string db_file;
+};
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue_bench [--stops=N] [--buses=N] [--stops-per-bus=N] [--queries=N]"
+              " [--repeat=N] [--seed=N] [--output=FILE] [--db=FILE]\n"sv;
+}
+
+// Разбирает параметры вида --name=value; false, если параметр неизвестен или значение не число
+bool ParseArgument(std::string_view arg, BenchConfig& config) {
+    const size_t eq = arg.find('=');
+    if (eq == std::string_view::npos) {
+        return false;
+    }
+    const std::string_view name = arg.substr(0, eq);
+    const std::string value(arg.substr(eq + 1));
+
+    if (name == "--output"sv) {
+        config.output = value;
+        return true;
+    }
+    if (name == "--db"sv) {
+        config.db_file = value;
+        return true;
+    }
+
+    int* target = name == "--stops"sv ? &config.stops
+                : name == "--buses"sv ? &config.buses
+                : name == "--stops-per-bus"sv ? &config.stops_per_bus
+                : name == "--queries"sv ? &config.queries
+                : name == "--repeat"sv ? &config.repeat
+                : name == "--seed"sv ? &config.seed
+                : nullptr;
+    if (target == nullptr) {
+        return false;
+    }
+    size_t parsed = 0;
+    try {
+        *target = std::stoi(value, &parsed);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return parsed == value.size() && (*target > 0 || target == &config.seed);
+}
+
+// Синтетическая сеть: остановки в прямоугольнике размером с большой город
+// и маршруты через случайные остановки
+struct Network {
+    struct StopData {
+        std::string name;
+        detail::Coordinates coords;
+    };
+    struct BusData {
+        std::string name;
+        std::vector<size_t> stops;
+        bool is_roundtrip;
+    };
+    struct DistanceData {
+        size_t from;
+        size_t to;
+        int meters;
+    };
+
+    std::vector<StopData> stops;
+    std::vector<BusData> buses;
+    std::vector<DistanceData> distances;
+};
+
+// std::mt19937 выдаёт одинаковые последовательности на всех платформах, а распределения стандартной
+// библиотеки — нет, поэтому числа из нужных диапазонов получаются здесь
+class Random {
+public:
+    explicit Random(int seed) : engine_(static_cast<std::mt19937::result_type>(seed)) {
+    }
+
+    double Uniform(double min, double max) {
+        return min + (max - min) * (engine_() / 4294967296.0);
+    }
+
+    size_t Index(size_t size) {
+        return static_cast<size_t>(engine_() % size);
+    }
+
+private:
+    std::mt19937 engine_;
+};
+
+Network GenerateNetwork(const BenchConfig& config) {
+    Random random(config.seed);
+    Network network;
+
+    network.stops.reserve(config.stops);
+    for (int i = 0; i < config.stops; ++i) {
+        network.stops.push_back({"Stop "s + std::to_string(i), {random.Uniform(55.5, 56.0), random.Uniform(37.3, 37.9)}});
+    }
+
+    network.buses.reserve(config.buses);
+    for (int i = 0; i < config.buses; ++i) {
+        Network::BusData bus{"Bus "s + std::to_string(i), {}, i % 2 == 0};
+        for (int j = 0; j < config.stops_per_bus; ++j) {
+            size_t stop = random.Index(network.stops.size());
+            // соседние остановки маршрута различны, иначе участок между ними имел бы нулевую длину
+            while (network.stops.size() > 1 && !bus.stops.empty() && bus.stops.back() == stop) {
+                stop = random.Index(network.stops.size());
+            }
+            bus.stops.push_back(stop);
+        }
+        if (bus.is_roundtrip) {
+            bus.stops.push_back(bus.stops.front());
+        }
+        for (size_t j = 1; j < bus.stops.size(); ++j) {
+            const auto& from = network.stops[bus.stops[j - 1]];
+            const auto& to = network.stops[bus.stops[j]];
+            // дороги длиннее прямой линии
+            const int meters = static_cast<int>(detail::ComputeDistance(from.coords, to.coords) * 1.3) + 1;
+            network.distances.push_back({bus.stops[j - 1], bus.stops[j], meters});
+        }
+        network.buses.push_back(std::move(bus));
+    }
+    return network;
+}
+
+// Документ для make_base с той же сетью
+std::string MakeBaseDocument(const Network& network, const std::string& db_file) {
+    std::vector<std::vector<const Network::DistanceData*>> distances_from(network.stops.size());
+    for (const auto& distance : network.distances) {
+        distances_from[distance.from].push_back(&distance);
+    }
+
+    json::Builder builder;
+    builder.StartDict(4).Key("base_requests"sv).StartArray(network.stops.size() + network.buses.size());
+    for (size_t i = 0; i < network.stops.size(); ++i) {
+        const auto& stop = network.stops[i];
+        builder.StartDict(5)
+            .Key("type"sv).ValueInDictItem("Stop"sv)
+            .Key("name"sv).ValueInDictItem(stop.name)
+            .Key("latitude"sv).ValueInDictItem(stop.coords.lat)
+            .Key("longitude"sv).ValueInDictItem(stop.coords.lng)
+            .Key("road_distances"sv).StartDict(distances_from[i].size());
+        for (const auto* distance : distances_from[i]) {
+            builder.Key(network.stops[distance->to].name).ValueInDictItem(distance->meters);
+        }
+        builder.EndDict().EndDict();
+    }
+    for (const auto& bus : network.buses) {
+        builder.StartDict(4)
+            .Key("type"sv).ValueInDictItem("Bus"sv)
+            .Key("name"sv).ValueInDictItem(bus.name)
+            .Key("is_roundtrip"sv).ValueInDictItem(bus.is_roundtrip)
+            .Key("stops"sv).StartArray(bus.stops.size());
+        for (size_t stop : bus.stops) {
+            builder.Value(network.stops[stop].name);
+        }
+        builder.EndArray().EndDict();
+    }
+    builder.EndArray();
+
+    builder.Key("render_settings"sv).StartDict()
+        .Key("width"sv).ValueInDictItem(1200.)
+        .Key("height"sv).ValueInDictItem(1200.)
+        .Key("padding"sv).ValueInDictItem(50.)
+        .Key("line_width"sv).ValueInDictItem(14.)
+        .Key("stop_radius"sv).ValueInDictItem(5.)
+        .Key("bus_label_font_size"sv).ValueInDictItem(20)
+        .Key("bus_label_offset"sv).ValueInDictItem(json::Array{7., 15.})
+        .Key("stop_label_font_size"sv).ValueInDictItem(20)
+        .Key("stop_label_offset"sv).ValueInDictItem(json::Array{7., -3.})
+        .Key("underlayer_color"sv).ValueInDictItem(json::Array{255, 255, 255, 0.85})
+        .Key("underlayer_width"sv).ValueInDictItem(3.)
+        .Key("color_palette"sv).ValueInDictItem(json::Array{"green"sv, json::Array{255, 160, 0}, "red"sv})
+    .EndDict();
+
+    builder.Key("routing_settings"sv).StartDict()
+        .Key("bus_wait_time"sv).ValueInDictItem(6)
+        .Key("bus_velocity"sv).ValueInDictItem(40.)
+    .EndDict();
+
+    builder.Key("serialization_settings"sv).StartDict()
+        .Key("file"sv).ValueInDictItem(db_file)
+    .EndDict();
+    builder.EndDict();
+
+    std::ostringstream out;
+    json::Print(json::Document{builder.Build()}, out, json::PrintStyle::COMPACT);
+    return out.str();
+}
+
+// Документ для process_requests: запросы Bus, Stop и Route вперемешку
+std::string ProcessRequestsDocument(const Network& network, const BenchConfig& config) {
+    Random random(config.seed + 1);
+
+    json::Builder builder;
+    builder.StartDict(2)
+        .Key("serialization_settings"sv).StartDict().Key("file"sv).ValueInDictItem(config.db_file).EndDict()
+        .Key("stat_requests"sv).StartArray(config.queries);
+    for (int i = 0; i < config.queries; ++i) {
+        builder.StartDict().Key("id"sv).ValueInDictItem(i);
+        switch (i % 4) {
+            case 0:
+                builder.Key("type"sv).ValueInDictItem("Bus"sv)
+                    .Key("name"sv).ValueInDictItem(network.buses[random.Index(network.buses.size())].name);
+                break;
+            case 1:
+                builder.Key("type"sv).ValueInDictItem("Stop"sv)
+                    .Key("name"sv).ValueInDictItem(network.stops[random.Index(network.stops.size())].name);
+                break;
+            default:
+                builder.Key("type"sv).ValueInDictItem("Route"sv)
+                    .Key("from"sv).ValueInDictItem(network.stops[random.Index(network.stops.size())].name)
+                    .Key("to"sv).ValueInDictItem(network.stops[random.Index(network.stops.size())].name);
+                break;
+        }
+        builder.EndDict();
+    }
+    builder.EndArray().EndDict();
+
+    std::ostringstream out;
+    json::Print(json::Document{builder.Build()}, out, json::PrintStyle::COMPACT);
+    return out.str();
+}
+
+std::vector<const Core::Stop*> AddStops(const Network& network, Core::TransportCatalogue& tc) {
+    std::vector<const Core::Stop*> stops;
+    stops.reserve(network.stops.size());
+    for (const auto& stop : network.stops) {
+        stops.push_back(tc.AddStop(stop.name, stop.coords));
+    }
+    tc.ReserveDistances(network.distances.size());
+    for (const auto& distance : network.distances) {
+        tc.SetDistanceBetweenStops(stops[distance.from], stops[distance.to], distance.meters);
+    }
+    return stops;
+}
+
+void AddBuses(const Network& network, const std::vector<const Core::Stop*>& stops, Core::TransportCatalogue& tc) {
+    std::vector<const Core::Stop*> bus_stops;
+    for (const auto& bus : network.buses) {
+        bus_stops.clear();
+        for (size_t stop : bus.stops) {
+            bus_stops.push_back(stops[stop]);
+        }
+        tc.AddBus(bus.name, bus_stops, bus.is_roundtrip);
+    }
+}
+
+// Отбрасывает всё, что в него выводится
+class NullBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override {
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Суммирует время участков, отмеченных вызовами Time; подготовка данных вне этих участков не учитывается
+class Stopwatch {
+public:
+    template <typename Func>
+    void Time(Func func) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        elapsed_ += std::chrono::steady_clock::now() - start;
+    }
+
+    double GetMilliseconds() const {
+        return std::chrono::duration<double, std::milli>(elapsed_).count();
+    }
+
+private:
+    std::chrono::steady_clock::duration elapsed_{};
+};
+
+struct BenchResult {
+    std::string name;
+    // элементов, обработанных за одну итерацию: запросов, маршрутов, остановок
+    size_t items;
+    std::vector<double> times_ms;
+};
+
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchConfig& config) : config_(config) {
+    }
+
+    // Выполняет run заданное число раз; run получает Stopwatch и отмечает им измеряемую часть итерации.
+    // Первая итерация не учитывается: она прогревает кэши и аллокатор
+    template <typename Run>
+    void Measure(std::string name, size_t items, Run run) {
+        BenchResult result{std::move(name), items, {}};
+        std::cerr << result.name << "..."sv << std::endl;
+        for (int i = 0; i <= config_.repeat; ++i) {
+            Stopwatch stopwatch;
+            run(stopwatch);
+            if (i > 0) {
+                result.times_ms.push_back(stopwatch.GetMilliseconds());
+            }
+        }
+        results_.push_back(std::move(result));
+    }
+
+    json::Node BuildReport(const Network& network, size_t make_base_bytes) const {
+        json::Builder builder;
+        builder.StartDict(2).Key("config"sv).StartDict()
+            .Key("stops"sv).ValueInDictItem(config_.stops)
+            .Key("buses"sv).ValueInDictItem(config_.buses)
+            .Key("stops_per_bus"sv).ValueInDictItem(config_.stops_per_bus)
+            .Key("queries"sv).ValueInDictItem(config_.queries)
+            .Key("repeat"sv).ValueInDictItem(config_.repeat)
+            .Key("seed"sv).ValueInDictItem(config_.seed)
+            .Key("road_distances"sv).ValueInDictItem(static_cast<int>(network.distances.size()))
+            .Key("make_base_bytes"sv).ValueInDictItem(static_cast<int>(make_base_bytes))
+        .EndDict();
+
+        builder.Key("benchmarks"sv).StartArray(results_.size());
+        for (const BenchResult& result : results_) {
+            std::vector<double> sorted = result.times_ms;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0;
+            for (double time : sorted) {
+                sum += time;
+            }
+            const double median = sorted.size() % 2 == 1
+                ? sorted[sorted.size() / 2]
+                : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2;
+
+            builder.StartDict(8)
+                .Key("name"sv).ValueInDictItem(result.name)
+                .Key("iterations"sv).ValueInDictItem(static_cast<int>(sorted.size()))
+                .Key("items"sv).ValueInDictItem(static_cast<int>(result.items))
+                .Key("min_ms"sv).ValueInDictItem(sorted.front())
+                .Key("median_ms"sv).ValueInDictItem(median)
+                .Key("mean_ms"sv).ValueInDictItem(sum / sorted.size())
+                .Key("max_ms"sv).ValueInDictItem(sorted.back())
+                .Key("median_ns_per_item"sv).ValueInDictItem(result.items > 0 ? median * 1e6 / result.items : 0.)
+            .EndDict();
+        }
+        return builder.EndArray().EndDict().Build();
+    }
+
+private:
+    const BenchConfig& config_;
+    std::vector<BenchResult> results_;
+};
+
+void RunBenchmarks(const BenchConfig& config, std::ostream& out) {
+    const Network network = GenerateNetwork(config);
+    const std::string make_base_text = MakeBaseDocument(network, config.db_file);
+    const std::string process_requests_text = ProcessRequestsDocument(network, config);
+    BenchRunner runner(config);
+
+    // Настройки отрисовки и маршрутизации берутся из того же документа, что получает make_base
+    Core::TransportCatalogue settings_tc;
+    std::istringstream settings_in(make_base_text);
+    Input::JSONReader settings_reader(settings_tc, settings_in);
+    settings_reader.ReadMakeBaseJSON();
+    const Render::RenderSettings render_settings = settings_reader.GetRenderSettings();
+    const Router::TransportRouterParameters router_settings = settings_reader.GetRouterSettings();
+
+    // Микробенчмарки
+
+    runner.Measure("json_load", network.stops.size() + network.buses.size(), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            const json::Document document = json::Load(std::string_view(make_base_text));
+        });
+    });
+
+    // Документ почти из одних дробных чисел: пары координат с полной точностью, как их выводит Print
+    std::string coordinates_text;
+    {
+        Random random(config.seed + 3);
+        json::Builder builder;
+        builder.StartArray(config.queries);
+        for (int i = 0; i < config.queries; ++i) {
+            const double lat = random.Uniform(-90., 90.);
+            builder.Value(json::Array{lat, random.Uniform(-180., 180.)});
+        }
+        std::ostringstream coordinates_out;
+        json::Print(json::Document{builder.EndArray().Build()}, coordinates_out, json::PrintStyle::COMPACT);
+        coordinates_text = coordinates_out.str();
+    }
+
+    runner.Measure("json_load_coordinates", 2 * static_cast<size_t>(config.queries), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            const json::Document document = json::Load(std::string_view(coordinates_text));
+        });
+    });
+
+    // Длины участков всех маршрутов: поштучно и пакетом, как в TransportCatalogue::GetBusInfo
+    std::vector<std::vector<detail::Coordinates>> bus_paths;
+    size_t path_segments = 0;
+    for (const auto& bus : network.buses) {
+        auto& path = bus_paths.emplace_back();
+        for (size_t stop : bus.stops) {
+            path.push_back(network.stops[stop].coords);
+        }
+        path_segments += path.size() - 1;
+    }
+    std::vector<double> segment_distances;
+    double distances_sum = 0;
+
+    runner.Measure("geo_compute_distance", path_segments, [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            for (const auto& path : bus_paths) {
+                for (size_t i = 1; i < path.size(); ++i) {
+                    distances_sum += detail::ComputeDistance(path[i - 1], path[i]);
+                }
+            }
+        });
+    });
+
+    runner.Measure("geo_distances_along_path", path_segments, [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            for (const auto& path : bus_paths) {
+                segment_distances.resize(path.size() - 1);
+                detail::ComputeDistancesAlongPath(path.data(), path.size(), segment_distances.data());
+                distances_sum += segment_distances.front();
+            }
+        });
+    });
+    if (!(distances_sum > 0)) {
+        throw std::logic_error("Zero route lengths"s);
+    }
+
+    runner.Measure("catalogue_add_bus", network.buses.size(), [&](Stopwatch& stopwatch) {
+        Core::TransportCatalogue tc;
+        const std::vector<const Core::Stop*> stops = AddStops(network, tc);
+        stopwatch.Time([&] {
+            AddBuses(network, stops, tc);
+        });
+    });
+
+    Core::TransportCatalogue tc;
+    AddBuses(network, AddStops(network, tc), tc);
+
+    runner.Measure("catalogue_get_bus_info", network.buses.size(), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            for (const auto& bus : network.buses) {
+                if (!tc.GetBusInfo(bus.name).has_value()) {
+                    throw std::logic_error("Bus "s + bus.name + " is lost"s);
+                }
+            }
+        });
+    });
+
+    runner.Measure("router_build", network.stops.size(), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            const Router::TransportRouter router(tc, router_settings);
+        });
+    });
+
+    const Router::TransportRouter router(tc, router_settings);
+    std::vector<std::pair<std::string_view, std::string_view>> route_queries;
+    route_queries.reserve(config.queries);
+    Random random(config.seed + 2);
+    for (int i = 0; i < config.queries; ++i) {
+        route_queries.emplace_back(network.stops[random.Index(network.stops.size())].name,
+                                   network.stops[random.Index(network.stops.size())].name);
+    }
+
+    runner.Measure("build_route", route_queries.size(), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            for (const auto& [from, to] : route_queries) {
+                router.BuildRoute(from, to);
+            }
+        });
+    });
+
+    Render::MapRenderer renderer(render_settings, tc.GetAllNonEmptyStopsCoords());
+    Router::TransportRouter handler_router(tc, router_settings);
+    ReqHandler::RequestHandler handler(tc, renderer, handler_router);
+    std::string map_svg;
+
+    runner.Measure("render_map", network.buses.size(), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            map_svg = handler.RenderMapSvg();
+        });
+    });
+
+    // svg::Document отдельно от раскладки карты: по кругу и две надписи на остановку, ломаная на маршрут
+    svg::Document document;
+    auto fill_document = [&] {
+        document.Clear();
+        document.Reserve(network.stops.size(), network.buses.size(), 2 * network.stops.size());
+        for (const auto& bus : network.buses) {
+            svg::Polyline line;
+            for (size_t stop : bus.stops) {
+                line.AddPoint({network.stops[stop].coords.lng * 1000., network.stops[stop].coords.lat * 1000.});
+            }
+            document.Add(std::move(line.SetStrokeColor("green"s).SetFillColor(svg::NoneColor).SetStrokeWidth(14.)));
+        }
+        for (const auto& stop : network.stops) {
+            const svg::Point point{stop.coords.lng * 1000., stop.coords.lat * 1000.};
+            document.Add(svg::Circle().SetCenter(point).SetRadius(5.).SetFillColor("white"s));
+            svg::Text label;
+            label.SetPosition(point).SetOffset({7., -3.}).SetFontSize(20).SetFontFamily("Verdana"s).SetData(stop.name);
+            svg::Text underlayer = label;
+            document.Add(std::move(underlayer.SetFillColor("white"s).SetStrokeColor("white"s).SetStrokeWidth(3.)));
+            document.Add(std::move(label.SetFillColor("black"s)));
+        }
+    };
+    const size_t document_objects = 3 * network.stops.size() + network.buses.size();
+
+    runner.Measure("svg_build_document", document_objects, [&](Stopwatch& stopwatch) {
+        stopwatch.Time(fill_document);
+    });
+
+    runner.Measure("svg_render_document", document_objects, [&](Stopwatch& stopwatch) {
+        fill_document();
+        NullBuffer null_buffer;
+        std::ostream null_stream(&null_buffer);
+        stopwatch.Time([&] {
+            document.Render(null_stream);
+        });
+    });
+
+    runner.Measure("serialize", network.stops.size() + network.buses.size(), [&](Stopwatch& stopwatch) {
+        Serialize::Serializator serializer(tc, Serialize::SerializationParameters{config.db_file});
+        stopwatch.Time([&] {
+            serializer.SerializeToFile(render_settings, router_settings, router, map_svg);
+        });
+    });
+
+    runner.Measure("unserialize", network.stops.size() + network.buses.size(), [&](Stopwatch& stopwatch) {
+        Core::TransportCatalogue loaded_tc;
+        Serialize::Serializator serializer(loaded_tc, Serialize::SerializationParameters{config.db_file});
+        stopwatch.Time([&] {
+            const Router::TransportRouter loaded_router = serializer.UnserializeFromFile();
+        });
+    });
+
+    // Макробенчмарки: режимы программы целиком, кроме чтения stdin
+
+    runner.Measure("make_base", network.stops.size() + network.buses.size(), [&](Stopwatch& stopwatch) {
+        stopwatch.Time([&] {
+            Core::TransportCatalogue base_tc;
+            std::istringstream in(make_base_text);
+            Input::JSONReader reader(base_tc, in);
+            reader.ReadMakeBaseJSON();
+            Serialize::Serializator serializer(base_tc, reader.GetSerializationSettings());
+            Router::TransportRouter base_router(base_tc, reader.GetRouterSettings());
+            Render::MapRenderer base_renderer(reader.GetRenderSettings(), base_tc.GetAllNonEmptyStopsCoords());
+            ReqHandler::RequestHandler base_handler(base_tc, base_renderer, base_router);
+            serializer.SerializeToFile(reader.GetRenderSettings(), reader.GetRouterSettings(), base_router,
+                                       base_handler.RenderMapSvg());
+        });
+    });
+
+    runner.Measure("process_requests", static_cast<size_t>(config.queries), [&](Stopwatch& stopwatch) {
+        NullBuffer null_buffer;
+        std::streambuf* const cout_buffer = std::cout.rdbuf(&null_buffer);
+        try {
+            stopwatch.Time([&] {
+                std::istringstream in(process_requests_text);
+                Input::JSONReader reader(in, json::PrintStyle::COMPACT);
+                reader.ReadProcessRequestsJSON();
+                const auto generation = Service::LoadBaseGeneration(reader.GetSerializationSettings(), 1);
+                reader.SendStatRequests(*generation->handler);
+            });
+        } catch (...) {
+            std::cout.rdbuf(cout_buffer);
+            throw;
+        }
+        std::cout.rdbuf(cout_buffer);
+    });
+
+    json::Print(json::Document{runner.BuildReport(network, make_base_text.size())}, out);
+    out << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        if (!ParseArgument(argv[i], config)) {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (config.db_file.empty()) {
+        config.db_file = (std::filesystem::temp_directory_path() / "transport_catalogue_bench.db").string();
+    }
+
+    if (config.output.empty()) {
+        RunBenchmarks(config, std::cout);
+        return 0;
+    }
+    std::ofstream out(config.output);
+    if (!out) {
+        std::cerr << "Can't open "sv << config.output << std::endl;
+        return 1;
+    }
+    RunBenchmarks(config, out);
+}
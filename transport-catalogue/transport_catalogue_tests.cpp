@@ -0,0 +1,664 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "spatial_index.h"
+#include "test_framework.h"
+#include "transport_catalogue.h"
+
+using namespace std::literals;
+
+// Глобальный operator new считает выделения, пока идёт замер (см. AllocationCounter)
+namespace
+{
+    std::atomic<bool> count_allocations{false};
+    std::atomic<size_t> allocations{0};
+
+    void* CountedAllocate(size_t size)
+    {
+        if (count_allocations.load(std::memory_order_relaxed))
+        {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return CountedAllocate(size);
+}
+
+// Формы nothrow тоже заменяются: память от них (например, буфер std::stable_sort) освобождается нашим delete
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return CountedAllocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace TransportInformator
+{
+
+namespace Tests
+{
+
+namespace
+{
+    // Число выделений памяти за время жизни объекта
+    class AllocationCounter
+    {
+        public:
+        AllocationCounter()
+        {
+            allocations = 0;
+            count_allocations = true;
+        }
+
+        ~AllocationCounter()
+        {
+            count_allocations = false;
+        }
+
+        size_t Get() const
+        {
+            return allocations;
+        }
+    };
+
+    // Отдаёт текст кусками не длиннее chunk символов: json::Load видит границу куска внутри чисел
+    class ChunkedStreambuf : public std::streambuf
+    {
+        public:
+        ChunkedStreambuf(std::string text, size_t chunk) : text_{std::move(text)}, chunk_{chunk} {}
+
+        protected:
+        int_type underflow() override
+        {
+            if (pos_ >= text_.size())
+            {
+                return traits_type::eof();
+            }
+            char* begin = text_.data() + pos_;
+            const size_t size = std::min(chunk_, text_.size() - pos_);
+            setg(begin, begin, begin + size);
+            pos_ += size;
+            return traits_type::to_int_type(*begin);
+        }
+
+        private:
+        std::string text_;
+        size_t chunk_;
+        size_t pos_ = 0;
+    };
+
+    struct NumberCase
+    {
+        enum class Kind
+        {
+            INT,
+            DOUBLE,
+            ERROR,
+        };
+
+        std::string text;
+        Kind kind;
+        double value = 0;
+    };
+
+    // Сравнивает узел с ожидаемым числом; у double совпадают все биты, включая знак нуля
+    void CheckNumber(const json::Node& node, const NumberCase& number, const std::string& hint)
+    {
+        if (number.kind == NumberCase::Kind::INT)
+        {
+            Assert(node.IsInt(), hint + ": not int"s);
+            AssertEqual(node.AsInt(), static_cast<int>(number.value), hint);
+            return;
+        }
+        Assert(node.IsPureDouble(), hint + ": not double"s);
+        const double value = node.AsDouble();
+        Assert(std::memcmp(&value, &number.value, sizeof(double)) == 0, hint + ": got "s + std::to_string(value));
+    }
+
+    // Документ make_base: stops остановок с расстояниями до двух следующих и buses маршрутов по 10 остановок
+    std::string MakeBaseFixture(int stops, int buses)
+    {
+        std::ostringstream out;
+        out << R"({"serialization_settings": {"file": "unused.db"},
+                   "routing_settings": {"bus_wait_time": 6, "bus_velocity": 40},
+                   "render_settings": {"width": 1200.0, "height": 1200.0, "padding": 50.0, "line_width": 14.0,
+                       "stop_radius": 5.0, "bus_label_font_size": 20, "bus_label_offset": [7.0, 15.0],
+                       "stop_label_font_size": 20, "stop_label_offset": [7.0, -3.0],
+                       "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3.0,
+                       "color_palette": ["green", [255, 160, 0], "red"]},
+                   "base_requests": [)";
+        for (int i = 0; i < stops; ++i)
+        {
+            out << R"({"type": "Stop", "name": "Stop number )" << i << R"(", "latitude": )" << 55.5 + i * 0.001
+                << R"(, "longitude": )" << 37.5 + (i % 17) * 0.002 << R"(, "road_distances": {"Stop number )"
+                << (i + 1) % stops << R"(": 900, "Stop number )" << (i + 2) % stops << R"(": 1700}}, )";
+        }
+        for (int i = 0; i < buses; ++i)
+        {
+            out << R"({"type": "Bus", "name": "Bus )" << i << R"(", "is_roundtrip": false, "stops": [)";
+            for (int j = 0; j < 10; ++j)
+            {
+                out << (j > 0 ? ", " : "") << R"("Stop number )" << (i * 3 + j) % stops << '"';
+            }
+            out << "]}" << (i + 1 < buses ? ", " : "");
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    // Остановки с именами S0, S1, ... Имена хранятся отдельно: Stop держит на них string_view
+    struct StopsFixture
+    {
+        explicit StopsFixture(const std::vector<detail::Coordinates>& coords)
+        {
+            names.reserve(coords.size());
+            stops.reserve(coords.size());
+            for (size_t i = 0; i < coords.size(); ++i)
+            {
+                names.push_back("S"s + std::to_string(i));
+                stops.push_back({names.back(), coords[i], static_cast<uint32_t>(i)});
+            }
+        }
+
+        std::vector<const Core::Stop*> GetPointers() const
+        {
+            std::vector<const Core::Stop*> result;
+            for (const Core::Stop& stop : stops)
+            {
+                result.push_back(&stop);
+            }
+            return result;
+        }
+
+        // Перебор всех остановок: эталон для индекса
+        std::vector<std::string_view> FindInRadius(detail::Coordinates center, double radius, size_t max_count) const
+        {
+            std::vector<Core::NearbyStop> found;
+            for (const Core::Stop& stop : stops)
+            {
+                const double distance = detail::ComputeDistance(center, stop.coords);
+                if (distance <= radius)
+                {
+                    found.push_back({stop.name, distance});
+                }
+            }
+            std::sort(found.begin(), found.end(), [](const Core::NearbyStop& lhs, const Core::NearbyStop& rhs)
+            {
+                return std::tie(lhs.distance, lhs.name) < std::tie(rhs.distance, rhs.name);
+            });
+            found.resize(std::min(found.size(), max_count));
+            return GetNames(found);
+        }
+
+        static std::vector<std::string_view> GetNames(const std::vector<Core::NearbyStop>& found)
+        {
+            std::vector<std::string_view> result;
+            for (const Core::NearbyStop& stop : found)
+            {
+                result.push_back(stop.name);
+            }
+            return result;
+        }
+
+        std::vector<std::string> names;
+        std::vector<Core::Stop> stops;
+    };
+
+    // 400 остановок по обе стороны антимеридиана: S200 стоит на -179.999, рядом с 180
+    std::vector<detail::Coordinates> MakeAntimeridianStops()
+    {
+        std::vector<detail::Coordinates> coords;
+        for (int i = 0; i < 400; ++i)
+        {
+            const double lat = 55. + (i % 20) * 0.01;
+            const double offset = 2.5 + (i / 20) * 0.07;
+            coords.push_back({lat, i % 2 == 0 ? 180. - offset : -180. + offset});
+        }
+        coords[200] = {55., -179.999};
+        return coords;
+    }
+}
+
+void TestComputeDistancesAlongPath()
+{
+    // Городские участки, повтор точки, полюс, антимеридиан и почти противоположные точки
+    const std::vector<detail::Coordinates> path{
+        {55.611087, 37.20829}, {55.595884, 37.209755}, {55.595884, 37.209755}, {55.632761, 37.333324},
+        {89.999, 10.}, {-89.999, -170.}, {0., 179.9999}, {0., -179.9999}, {-33.86, 151.2}, {33.86, -28.8},
+        {43.587795, 39.716901}, {43.581969, 39.719848}};
+
+    std::vector<double> distances(path.size() - 1);
+    detail::ComputeDistancesAlongPath(path.data(), path.size(), distances.data());
+
+    for (size_t i = 0; i + 1 < path.size(); ++i)
+    {
+        const double expected = detail::ComputeDistance(path[i], path[i + 1]);
+        const std::string hint = "segment "s + std::to_string(i);
+        if (expected == 0)
+        {
+            AssertEqual(distances[i], 0., hint);
+            continue;
+        }
+        Assert(std::abs(distances[i] - expected) <= 1e-9 * expected, hint);
+    }
+
+    // Пути из одной точки не содержат отрезков, distances не трогается
+    double untouched = -1;
+    detail::ComputeDistancesAlongPath(path.data(), 1, &untouched);
+    ASSERT_EQUAL(untouched, -1.);
+}
+
+void TestLoadNumbers()
+{
+    using Kind = NumberCase::Kind;
+    const std::vector<NumberCase> numbers{
+        {"0", Kind::INT, 0},
+        {"-0", Kind::INT, 0},
+        {"-0.0", Kind::DOUBLE, -0.},
+        {"0e5", Kind::DOUBLE, 0.},
+        {"2147483647", Kind::INT, INT_MAX},
+        {"2147483648", Kind::DOUBLE, 2147483648.},
+        {"-2147483648", Kind::INT, INT_MIN},
+        {"-2147483649", Kind::DOUBLE, -2147483649.},
+        {"12345678901234567890", Kind::DOUBLE, 12345678901234567890.},
+        {"37.6155512", Kind::DOUBLE, 37.6155512},
+        {"-0.000001", Kind::DOUBLE, -0.000001},
+        {"1E2", Kind::DOUBLE, 100.},
+        {"1e+2", Kind::DOUBLE, 100.},
+        {"25e-1", Kind::DOUBLE, 2.5},
+        {"1.7976931348623157e308", Kind::DOUBLE, DBL_MAX},
+        {"2.2250738585072014e-308", Kind::DOUBLE, DBL_MIN},
+        // денормализованные числа и переполнение отвергаются
+        {"2.2250738585072009e-308", Kind::ERROR},
+        {"4.9e-324", Kind::ERROR},
+        {"1e-400", Kind::ERROR},
+        {"1e309", Kind::ERROR},
+        {"-1e309", Kind::ERROR},
+        // не числа JSON
+        {"-", Kind::ERROR},
+        {"+1", Kind::ERROR},
+        {".5", Kind::ERROR},
+        {"1.", Kind::ERROR},
+        {"1e", Kind::ERROR},
+        {"1e+", Kind::ERROR},
+        {"--1", Kind::ERROR},
+    };
+
+    for (const NumberCase& number : numbers)
+    {
+        // Сдвиг числа внутри документа меняет положение границ кусков
+        for (const std::string& prefix : {"["s, "[ "s, "[  "s})
+        {
+            const std::string text = prefix + number.text + "]"s;
+            for (size_t chunk : {0u, 1u, 2u, 3u})
+            {
+                const std::string hint = "\""s + text + "\" in chunks of "s + std::to_string(chunk);
+                try
+                {
+                    std::optional<json::Document> document;
+                    ChunkedStreambuf buf(text, chunk);
+                    std::istream in(&buf);
+                    // кусок 0 — разбор строки без потока
+                    document.emplace(chunk == 0 ? json::Load(std::string_view(text)) : json::Load(in));
+                    Assert(number.kind != Kind::ERROR, hint + ": no error"s);
+                    const json::Array& items = document->GetRoot().AsArray();
+                    AssertEqual(items.size(), 1u, hint);
+                    CheckNumber(items.front(), number, hint);
+                }
+                catch (const json::ParsingError&)
+                {
+                    Assert(number.kind == Kind::ERROR, hint + ": unexpected ParsingError"s);
+                }
+            }
+        }
+    }
+}
+
+// Ключи приходят в любом порядке, а словарь упорядочен по ключу; повтор ключа — ошибка разбора
+void TestLoadDict()
+{
+    std::string text = "{";
+    for (int i = 999; i >= 0; --i)
+    {
+        text += "\"k"s + std::to_string(i * 7919 % 1000) + "\": "s + std::to_string(i) + (i > 0 ? ", "s : ""s);
+    }
+    text += "}";
+    const json::Document doc = json::Load(std::string_view{text});
+    const json::Dict& dict = doc.GetRoot().AsDict();
+    ASSERT_EQUAL(dict.size(), 1000u);
+    ASSERT(std::is_sorted(dict.begin(), dict.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; }));
+    ASSERT_EQUAL(dict.at("k919").AsInt(), 1);
+
+    bool duplicate_rejected = false;
+    try
+    {
+        json::Load(R"({"b": 1, "a": 2, "b": 3})"sv);
+    }
+    catch (const json::ParsingError&)
+    {
+        duplicate_rejected = true;
+    }
+    ASSERT(duplicate_rejected);
+
+    // insert оставляет прежнее значение ключа и первое из новых
+    json::Dict merged;
+    merged["b"] = 1;
+    const std::vector<json::Dict::value_type> items{{"c", 2}, {"b", 3}, {"a", 4}, {"c", 5}};
+    merged.insert(items.begin(), items.end());
+    ASSERT_EQUAL(merged.size(), 3u);
+    ASSERT_EQUAL(merged.at("a").AsInt(), 4);
+    ASSERT_EQUAL(merged.at("b").AsInt(), 1);
+    ASSERT_EQUAL(merged.at("c").AsInt(), 2);
+}
+
+void TestArrayPrinter()
+{
+    json::Array items{1, "two"s, json::Array{3.5, nullptr}};
+    for (json::PrintStyle style : {json::PrintStyle::COMPACT, json::PrintStyle::PRETTY})
+    {
+        std::ostringstream expected;
+        json::Print(json::Node{items}, expected, style);
+
+        std::ostringstream out;
+        {
+            json::ArrayPrinter printer(out, style);
+            for (const json::Node& item : items)
+            {
+                printer.Print(item);
+            }
+            printer.Finish();
+        }
+        ASSERT_EQUAL(out.str(), expected.str());
+    }
+
+    // Без Finish выведенные элементы всё равно попадают в поток, а массив остаётся незакрытым
+    std::ostringstream out;
+    try
+    {
+        json::ArrayPrinter printer(out, json::PrintStyle::COMPACT);
+        printer.Print(1);
+        printer.Print("two"s);
+        throw std::runtime_error("request failed");
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+    ASSERT_EQUAL(out.str(), "[1,\"two\""s);
+}
+
+// Проверки, общие для запросов из JSON и из двоичного ввода
+// Ответ, построенный в арене с достаточным буфером, не выделяет память в куче; копия ответа не зависит от арены
+void TestBuilderResource()
+{
+    std::array<std::byte, 16 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size()};
+    json::Node copy;
+    size_t count = 0;
+    {
+        AllocationCounter counter;
+        json::Builder builder{&arena};
+        builder.StartDict(3)
+            .Key("request_id"sv).ValueInDictItem(7)
+            .Key("unique_stop_count"sv).ValueInDictItem(3)
+            .Key("items"sv).StartArray(10);
+        for (int i = 0; i < 10; ++i)
+        {
+            builder.StartDict(2).Key("type"sv).ValueInDictItem("Wait"sv).Key("time"sv).ValueInDictItem(i).EndDict();
+        }
+        const json::Node response = builder.EndArray().EndDict().Build();
+        count = counter.Get();
+        copy = response;
+    }
+    ASSERT_EQUAL(count, 0u);
+
+    arena.release();
+    std::fill(buffer.begin(), buffer.end(), std::byte{0xFF});
+    const json::Dict& dict = copy.AsDict();
+    ASSERT_EQUAL(dict.at("unique_stop_count").AsInt(), 3);
+    ASSERT_EQUAL(dict.at("items").AsArray().size(), 10u);
+    ASSERT_EQUAL(dict.at("items").AsArray()[9].AsDict().at("time").AsInt(), 9);
+}
+
+void TestMakeRequestValidation()
+{
+    auto throws_invalid_argument = [](auto make)
+    {
+        try
+        {
+            make();
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    };
+
+    const detail::Coordinates center{55.6, 37.6};
+    ASSERT_EQUAL(Input::MakeNearestStopsRequest(1, center, 500., std::nullopt)->radius.value_or(0.), 500.);
+    ASSERT_EQUAL(*Input::MakeNearestStopsRequest(2, center, std::nullopt, 0)->count, 0u);
+    ASSERT(throws_invalid_argument([&] { Input::MakeNearestStopsRequest(3, center, std::nullopt, std::nullopt); }));
+    ASSERT(throws_invalid_argument([&] { Input::MakeNearestStopsRequest(4, center, 500., -1); }));
+
+    const Render::MapViewport area{{55.5, 37.3}, {55.9, 37.9}, 800., std::nullopt};
+    ASSERT_EQUAL(Input::MakeMapTileRequest(5, area)->id, 5u);
+    ASSERT_EQUAL(Input::MakeMapTileRequest(6, Render::GetTileViewport(30, 5, 7))->id, 6u);
+    ASSERT(throws_invalid_argument([&] { Input::MakeMapTileRequest(7, {{55.9, 37.3}, {55.5, 37.9}, std::nullopt, std::nullopt}); }));
+    ASSERT(throws_invalid_argument([&] { Input::MakeMapTileRequest(8, {{55.5, 37.3}, {55.5, 37.9}, std::nullopt, std::nullopt}); }));
+    ASSERT(throws_invalid_argument([&] { Input::MakeMapTileRequest(9, {{55.5, 37.3}, {55.9, 37.9}, 0., std::nullopt}); }));
+    ASSERT(throws_invalid_argument([&] { Input::MakeMapTileRequest(10, {{55.5, 37.3}, {55.9, 37.9}, std::nullopt, -1.}); }));
+}
+
+// Повтор ссылается на первый такой же запрос; пакет без повторов не выделяет память на каждый запрос
+void TestFindRepeatedRequests()
+{
+    using Input::StatRequestType;
+    std::vector<std::unique_ptr<Input::StatRequest>> requests;
+    requests.push_back(std::make_unique<Input::BusInfoRequest>(1, StatRequestType::BUS, "14"s));
+    requests.push_back(std::make_unique<Input::StopInfoRequest>(2, StatRequestType::STOP, "14"s));
+    requests.push_back(std::make_unique<Input::RouteRequest>(3, StatRequestType::ROUTE, "A"s, "BC"s));
+    requests.push_back(std::make_unique<Input::RouteRequest>(4, StatRequestType::ROUTE, "AB"s, "C"s));
+    requests.push_back(std::make_unique<Input::InvalidRequest>(5, "bad"s));
+    requests.push_back(std::make_unique<Input::InvalidRequest>(6, "bad"s));
+    requests.push_back(std::make_unique<Input::BusInfoRequest>(7, StatRequestType::BUS, "14"s));
+    requests.push_back(std::make_unique<Input::RouteRequest>(8, StatRequestType::ROUTE, "A"s, "BC"s));
+    ASSERT_EQUAL(Input::FindRepeatedRequests(requests), (std::vector<size_t>{0, 1, 2, 3, 4, 5, 0, 2}));
+
+    requests.clear();
+    for (int i = 0; i < 1000; ++i)
+    {
+        requests.push_back(std::make_unique<Input::StopInfoRequest>(i, StatRequestType::STOP, "Stop "s + std::to_string(i)));
+    }
+    size_t count = 0;
+    {
+        AllocationCounter counter;
+        const std::vector<size_t> first = Input::FindRepeatedRequests(requests);
+        count = counter.Get();
+        ASSERT_EQUAL(first.back(), 999u);
+    }
+    Assert(count <= 8, std::to_string(count) + " allocations for 1000 distinct requests"s);
+}
+
+// Разбор make_base не копирует узлы документа: число выделений растёт не быстрее справочника
+void TestReadMakeBaseAllocations()
+{
+    for (auto [stops, buses] : {std::pair{100, 20}, std::pair{400, 80}})
+    {
+        std::istringstream in(MakeBaseFixture(stops, buses));
+        Core::TransportCatalogue tc;
+        Input::JSONReader reader(tc, in);
+        size_t count = 0;
+        {
+            AllocationCounter counter;
+            reader.ReadMakeBaseJSON();
+            count = counter.Get();
+        }
+        ASSERT_EQUAL(tc.GetAllStops().size(), static_cast<size_t>(stops));
+        // Сейчас выходит 6-7 выделений на запрос, почти все — индексы справочника.
+        // Копии поддеревьев документа на каждый запрос давали около 12
+        const size_t requests = static_cast<size_t>(stops + buses);
+        Assert(count <= 8 * requests, std::to_string(count) + " allocations for "s + std::to_string(requests) + " requests"s);
+    }
+}
+
+// Карта, выведенная в поток (на многоядерной машине — параллельно), совпадает с выводом svg::Document
+// и при формате чисел потока, отличном от принятого по умолчанию
+void TestRenderMapKeepsStreamFormat()
+{
+    std::vector<detail::Coordinates> coords;
+    for (int i = 0; i < 3000; ++i)
+    {
+        coords.push_back({55.5 + (i / 60) * 0.003, 37.4 + (i % 60) * 0.004});
+    }
+    const StopsFixture fixture{coords};
+    const std::vector<const Core::Stop*> stops = fixture.GetPointers();
+    std::vector<Render::BusDrawingInfo> buses;
+    for (size_t i = 0; i + 10 <= stops.size(); i += 10)
+    {
+        buses.push_back({fixture.names[i], detail::Span<const Core::Stop*>{stops.data() + i, 10}, i % 20 == 0});
+    }
+    const Render::RenderSettings settings{1200., 1200., 50., 14., 5., 20, {7., 15.}, 20, {7., -3.},
+                                          svg::Rgba{255, 255, 255, 0.85}, 3., {"green"s, svg::Rgb{255, 160, 0}, "red"s},
+                                          0., false};
+
+    for (const std::streamsize precision : {std::streamsize{6}, std::streamsize{3}})
+    {
+        Render::MapRenderer document_renderer{settings, coords};
+        std::ostringstream expected;
+        expected.precision(precision);
+        document_renderer.RenderMap(buses, stops).Render(expected);
+
+        Render::MapRenderer stream_renderer{settings, coords};
+        std::ostringstream out;
+        out.precision(precision);
+        stream_renderer.RenderMap(buses, stops, out);
+        AssertEqual(out.str(), expected.str(), "precision "s + std::to_string(precision));
+    }
+}
+
+void TestFindInRadiusAcrossAntimeridian()
+{
+    const StopsFixture fixture{MakeAntimeridianStops()};
+    const Core::StopsSpatialIndex index{fixture.GetPointers()};
+
+    const detail::Coordinates center{55., 179.999};
+    const auto found = StopsFixture::GetNames(index.FindInRadius(center, 1000, 100));
+    ASSERT_EQUAL(found, std::vector<std::string_view>{"S200"sv});
+
+    for (double lng : {179.999, 179.0, 178.5, -179.0, -178.5})
+    {
+        for (double radius : {1000., 50000., 120000., 300000.})
+        {
+            const detail::Coordinates point{55.05, lng};
+            AssertEqual(StopsFixture::GetNames(index.FindInRadius(point, radius, 1000)),
+                        fixture.FindInRadius(point, radius, 1000),
+                        "lng "s + std::to_string(lng) + ", radius "s + std::to_string(radius));
+        }
+    }
+}
+
+void TestFindNearestAcrossAntimeridian()
+{
+    const StopsFixture fixture{MakeAntimeridianStops()};
+    const Core::StopsSpatialIndex index{fixture.GetPointers()};
+
+    ASSERT_EQUAL(StopsFixture::GetNames(index.FindNearest({55., 179.}, 1)), std::vector<std::string_view>{"S200"sv});
+
+    for (double lng : {179.999, 179.0, 178.0, -179.999, -179.0})
+    {
+        for (size_t count : {1u, 2u, 10u, 50u})
+        {
+            const detail::Coordinates point{55.1, lng};
+            AssertEqual(StopsFixture::GetNames(index.FindNearest(point, count)),
+                        fixture.FindInRadius(point, detail::EARTH_RADIUS * 4, count),
+                        "lng "s + std::to_string(lng) + ", count "s + std::to_string(count));
+        }
+    }
+}
+
+} // namespace TransportInformator::Tests
+
+} // namespace TransportInformator
+
+int main()
+{
+    using namespace TransportInformator::Tests;
+
+    TestRunner tr;
+    RUN_TEST(tr, TestComputeDistancesAlongPath);
+    RUN_TEST(tr, TestLoadNumbers);
+    RUN_TEST(tr, TestLoadDict);
+    RUN_TEST(tr, TestArrayPrinter);
+    RUN_TEST(tr, TestBuilderResource);
+    RUN_TEST(tr, TestMakeRequestValidation);
+    RUN_TEST(tr, TestFindRepeatedRequests);
+    RUN_TEST(tr, TestReadMakeBaseAllocations);
+    RUN_TEST(tr, TestRenderMapKeepsStreamFormat);
+    RUN_TEST(tr, TestFindInRadiusAcrossAntimeridian);
+    RUN_TEST(tr, TestFindNearestAcrossAntimeridian);
+}
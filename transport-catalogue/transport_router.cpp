@@ -32,7 +32,7 @@ bus_wait_time_{pars.bus_wait_time}, bus_velocity_{pars.bus_velocity}, tc_{tc}, g
                                      std::unordered_map<size_t, std::string> edge_id_to_bus_name,
                                      std::unordered_map<size_t, int> edge_id_to_span_count) :
                     bus_wait_time_{pars.bus_wait_time}, bus_velocity_{pars.bus_velocity}, tc_{tc},
-                    graph_{graph}, router_{router}, edge_id_to_bus_name_(std::move(edge_id_to_bus_name)),
+                    graph_{graph}, router_{std::in_place, graph_.value(), router.GetRoutesInternalData()}, edge_id_to_bus_name_(std::move(edge_id_to_bus_name)),
                     edge_id_to_span_count_(std::move(edge_id_to_span_count))
     {
         const std::set<std::string_view> all_stops = tc_.GetAllStops();
@@ -73,6 +73,10 @@ class TransportRouter
                     std::unordered_map<size_t, int> edge_id_to_span_count
                     );
 
+    // Внутренний маршрутизатор ссылается на граф этого же объекта, поэтому копировать и перемещать его нельзя
+    TransportRouter(const TransportRouter&) = delete;
+    TransportRouter& operator=(const TransportRouter&) = delete;
+
     std::optional<Route> BuildRoute(std::string_view from, std::string_view to) const;
 
     graph::DirectedWeightedGraph<double> GetGraph() const